@@ -2,15 +2,20 @@
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <optional>
 #include <llvm-14/llvm/IR/Module.h>
 #include <llvm/Support/raw_ostream.h>
 #include <sstream>
 #include <system_error>
 #include <utility>
+#include "src/core/ast/ModuleFile.h"
+#include "src/core/ctfe/Interpreter.h"
+#include "src/core/incremental/IncrementalFrontend.h"
 #include "src/core/lexer/Lexer.h"
 #include "src/core/parser/Parser.h"
 #include "src/core/sema/Sema.h"
 #include "src/core/codegen/Codegen.h"
+#include "src/utils/Diagnostics.h"
 #include "src/utils/Driver.h"
 #include "src/utils/Utils.h"
 
@@ -24,35 +29,121 @@ int main(int argc, const char **argv) {
     if(options.source.empty())
         hlx::error("no source file empty");
 
-    if(options.source.extension()!=".hlx")
+    // Owns every AST and resolved node, both trees are released at exit.
+    hlx::Arena arena;
+    hlx::SourceFile sourceFile;
+    std::optional<hlx::ModuleFile> moduleFile;
+    // Diagnostics are buffered until a phase is done, they are written out
+    // before any dump and when main returns, while the source is still alive.
+    hlx::DiagnosticEngine::get().setErrorLimit(options.errorLimit);
+    struct FlushDiagnostics{
+        ~FlushDiagnostics(){hlx::DiagnosticEngine::get().flush();}
+    } flushDiagnostics;
+    std::vector<hlx::ResolvedFunctionDecl *> resolvedTree;
+    std::optional<hlx::Codegen> codegen;
+    llvm::Module *llvmIR=nullptr;
+
+    if(options.source.extension()==".hlxr"){
+        // Already resolved, lexing, parsing and sema are skipped.
+        if(options.astDump)
+            hlx::error("a resolved module has no AST to dump");
+
+        std::string errorMessage;
+        moduleFile=hlx::ModuleFile::open(options.source,errorMessage);
+        if(!moduleFile)
+            hlx::error(errorMessage);
+        // The dump reads the mapped records, only codegen needs the tree.
+        if(options.resDump){
+            moduleFile->dump();
+            return 0;
+        }
+        resolvedTree=moduleFile->toTree(arena);
+    }
+    else if(options.source.extension()!=".hlx")
         hlx::error("unexpected source file extension");
-    
-    std::ifstream file(options.source);
-    if(!file)
-        hlx::error("failed to open '"+options.source.string()+'\'');
-
-    std::stringstream buffer;
-    buffer<<file.rdbuf();
-    hlx::SourceFile sourceFile={options.source.c_str(),buffer.str()};
-
-    hlx::Lexer lexer(sourceFile);
-    hlx::Parser parser(lexer);
-
-    auto [ast,success]=parser.parseSourceFile();
+    else{
+        std::ifstream file(options.source);
+        if(!file)
+            hlx::error("failed to open '"+options.source.string()+'\'');
+
+        std::stringstream buffer;
+        buffer<<file.rdbuf();
+        sourceFile={options.source.c_str(),buffer.str()};
+
+        if(options.verifyLex)
+            return !hlx::verifyParallelTokenize(sourceFile,options.jobs);
+        if(options.verifyIncremental)
+            return !hlx::verifyIncremental(sourceFile);
+
+        if(options.stream){
+            if(options.resDump || !options.emitRes.empty())
+                hlx::error("a streamed compilation keeps no resolved tree");
+            // Compile-time evaluation needs the bodies of the callees.
+            if(options.ctfe)
+                hlx::error("-fctfe cannot be combined with -stream");
+            options.lazyBodies=true;
+        }
+        if(options.jobs>1 || options.lazyBodies)
+            options.preLex=true;
+
+        hlx::Lexer lexer(sourceFile);
+        hlx::TokenBuffer tokens=options.jobs>1
+                                    ? hlx::tokenizeParallel(sourceFile,options.jobs)
+                                : options.preLex ? lexer.tokenize()
+                                                 : hlx::TokenBuffer(sourceFile);
+        std::optional<hlx::PipelinedLexer> pipeline;
+        if(options.pipeline && !options.preLex)
+            pipeline.emplace(sourceFile);
+
+        auto [ast,success]=
+            options.jobs>1 ? hlx::Parser::parseSourceFileParallel(tokens,arena,options.jobs,options.lazyBodies)
+            : options.preLex ? hlx::Parser(tokens,arena).setLazyBodies(options.lazyBodies).parseSourceFile()
+            : pipeline       ? hlx::Parser(*pipeline,arena).parseSourceFile()
+                             : hlx::Parser(lexer,arena).parseSourceFile();
+        // Joins the lexer thread, it might still be interning constants if
+        // parsing stopped early.
+        pipeline.reset();
+
+        if(options.astDump){
+            hlx::DiagnosticEngine::get().flush();
+            for(auto &&fn:ast){
+                fn->dump();
+            }
+            return 0;
+        }
 
-    if(options.astDump){
-        for(auto &&fn:ast){
-            fn->dump();
+        if(!success)
+            return 1;
+
+        hlx::Sema sema(std::move(ast),arena);
+        sema.setBodyParser([&](hlx::FunctionDecl &fn,hlx::Arena &bodyArena){
+            return hlx::Parser::parseDeferredBody(tokens,bodyArena,fn);
+        });
+        sema.setCheckAll(options.checkAll);
+        if(options.stream){
+            // Each body is lowered while it is the only one alive, only the
+            // signatures and the llvm module outlive it.
+            codegen.emplace(std::vector<hlx::ResolvedFunctionDecl *>{},options.source.c_str());
+            resolvedTree=sema.resolveStreaming([&](hlx::ResolvedFunctionDecl &fn){
+                codegen->generateFunctionBody(fn);
+            });
+            if(resolvedTree.empty())
+                return 1;
+            llvmIR=codegen->finishModule(resolvedTree);
+        }
+        else
+            resolvedTree=sema.resolveAST(options.jobs);
+        if(options.ctfe && !resolvedTree.empty())
+            hlx::evaluateConstantCalls(resolvedTree,arena);
+
+        if(!options.emitRes.empty() && !resolvedTree.empty()){
+            if(!hlx::ModuleFile::write(resolvedTree,sourceFile,options.emitRes))
+                hlx::error("failed to write '"+options.emitRes.string()+'\'');
+            return 0;
         }
-        return 0;
     }
 
-    if(!success)
-        return 1;
-
-    hlx::Sema sema(std::move(ast));
-    auto resolvedTree=sema.resolveAST();
-
+    hlx::DiagnosticEngine::get().flush();
     if(options.resDump){
         for(auto &&fn:resolvedTree)
             fn->dump();
@@ -63,9 +154,10 @@ int main(int argc, const char **argv) {
         return 1;
     }
 
-    hlx::Codegen codegen(std::move(resolvedTree),options.source.c_str());
-
-    llvm::Module *llvmIR=codegen.generateIR();
+    if(!llvmIR){
+        codegen.emplace(std::move(resolvedTree),options.source.c_str());
+        llvmIR=codegen->generateIR();
+    }
     if(options.llvmDump){
         llvmIR->dump();
         return 0;
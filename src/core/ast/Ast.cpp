@@ -11,7 +11,8 @@ void hlx::FunctionDecl::dump(size_t level) const {
   for (auto &&param : params)
     param->dump(level + 1);
 
-  body->dump(level + 1);
+  if (body)
+    body->dump(level + 1);
 }
 
 void hlx::VarDecl::dump(size_t level) const {
@@ -49,7 +50,8 @@ void hlx::ReturnStmt::dump(size_t level) const {
 }
 
 void hlx::NumberLiteral::dump(size_t level) const {
-  std::cerr << indent(level) << "NumberLiteral: '" << value << "'\n";
+  std::cerr << indent(level) << "NumberLiteral: '"
+            << ConstantPool::get().getValue(constant) << "'\n";
 }
 
 void hlx::DeclRefExpr::dump(size_t level) const {
@@ -90,6 +92,12 @@ std::string_view hlx::getOpStr(hlx::TokenKind op) {
     return "<";
   if (op == TokenKind::Gt)
     return ">";
+  if (op == TokenKind::Mod)
+    return "%";
+  if (op == TokenKind::LessThanEql)
+    return "<=";
+  if (op == TokenKind::MoreThanEql)
+    return ">=";
   if (op == TokenKind::Excl)
     return "!";
 
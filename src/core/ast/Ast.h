@@ -1,10 +1,12 @@
 #pragma once
 
+#include "../../utils/ConstantPool.h"
 #include "../../utils/Utils.h"
 #include "../lexer/Token.h"
 #include <cstddef>
+#include <llvm-14/llvm/ADT/ArrayRef.h>
+#include <llvm-14/llvm/Support/Casting.h>
 #include <llvm-14/llvm/Support/ErrorHandling.h>
-#include <memory>
 #include <optional>
 #include <string_view>
 #include <utility>
@@ -12,193 +14,284 @@
 
 namespace hlx {
 std::string_view getOpStr(TokenKind op);
+
+// Nodes are allocated in an Arena and never destroyed, children are
+// non-owning pointers into the same arena.
+//
+// Every node carries its Kind, passes dispatch with a switch over it and
+// downcast with llvm::isa/cast/dyn_cast through the classof() hooks.
 struct Decl : public Dumpable {
+  enum class Kind { ParamDecl, FunctionDecl, VarDecl };
+
+  const Kind kind;
   SourceLocation location;
-  std::string identifier;
+  Symbol identifier;
 
-  Decl(SourceLocation location, std::string identifier)
-      : location(location), identifier(std::move(identifier)) {}
+  Decl(Kind kind, SourceLocation location, Symbol identifier)
+      : kind(kind), location(location), identifier(identifier) {}
 
   virtual ~Decl() = default;
+  Kind getKind() const { return kind; }
 };
 struct Stmt : public Dumpable {
+  enum class Kind {
+    ReturnStmt,
+    IfStmt,
+    WhileStmt,
+    DeclStmt,
+    Assignment,
+
+    NumberLiteral,
+    DeclRefExpr,
+    CallExpr,
+    BinaryOperator,
+    UnaryOperator,
+    GroupingExpr,
+
+    FirstExpr = NumberLiteral,
+    LastExpr = GroupingExpr
+  };
+
+  const Kind kind;
   SourceLocation location;
-  Stmt(SourceLocation location) : location(location) {}
+  Stmt(Kind kind, SourceLocation location) : kind(kind), location(location) {}
   virtual ~Stmt() = default;
+  Kind getKind() const { return kind; }
 };
 
 struct Expr : public Stmt {
-  Expr(SourceLocation location) : Stmt(location) {}
+  Expr(Kind kind, SourceLocation location) : Stmt(kind, location) {}
+
+  static bool classof(const Stmt *stmt) {
+    return stmt->getKind() >= Kind::FirstExpr &&
+           stmt->getKind() <= Kind::LastExpr;
+  }
 };
 
 struct DeclRefExpr : public Expr {
-  std::string identifier;
-  DeclRefExpr(SourceLocation location, std::string identifer)
-      : Expr(location), identifier(identifer) {}
+  Symbol identifier;
+  DeclRefExpr(SourceLocation location, Symbol identifer)
+      : Expr(Kind::DeclRefExpr, location), identifier(identifer) {}
   void dump(size_t level = 0) const override;
   std::string indent(size_t level) const { return std::string(level * 2, ' '); }
+
+  static bool classof(const Stmt *stmt) {
+    return stmt->getKind() == Kind::DeclRefExpr;
+  }
 };
 
 struct CallExpr : public Expr {
-  std::unique_ptr<DeclRefExpr> identifier;
-  std::vector<std::unique_ptr<Expr>> arguments;
+  DeclRefExpr *identifier;
+  llvm::ArrayRef<Expr *> arguments;
 
-  CallExpr(SourceLocation location, std::unique_ptr<DeclRefExpr> identifier,
-           std::vector<std::unique_ptr<Expr>> arguments)
-      : Expr(location), identifier(std::move(identifier)),
-        arguments(std::move(arguments)) {}
+  CallExpr(SourceLocation location, DeclRefExpr *identifier,
+           llvm::ArrayRef<Expr *> arguments)
+      : Expr(Kind::CallExpr, location), identifier(identifier),
+        arguments(arguments) {}
   void dump(size_t level = 0) const override;
   std::string indent(size_t level) const { return std::string(level * 2, ' '); }
+
+  static bool classof(const Stmt *stmt) {
+    return stmt->getKind() == Kind::CallExpr;
+  }
 };
 
 struct NumberLiteral : public Expr {
-  std::string value;
-  NumberLiteral(SourceLocation location, std::string value)
-      : Expr(location), value(value) {}
+  uint32_t constant;
+  NumberLiteral(SourceLocation location, uint32_t constant)
+      : Expr(Kind::NumberLiteral, location), constant(constant) {}
 
   void dump(size_t level = 0) const override;
   std::string indent(size_t level) const { return std::string(level * 2, ' '); }
+
+  static bool classof(const Stmt *stmt) {
+    return stmt->getKind() == Kind::NumberLiteral;
+  }
 };
 
 struct ReturnStmt : public Stmt {
-  std::unique_ptr<Expr> expr;
-  ReturnStmt(SourceLocation location, std::unique_ptr<Expr> expr = nullptr)
-      : Stmt(location), expr(std::move(expr)) {}
+  Expr *expr;
+  ReturnStmt(SourceLocation location, Expr *expr = nullptr)
+      : Stmt(Kind::ReturnStmt, location), expr(expr) {}
 
   void dump(size_t level = 0) const override;
+
+  static bool classof(const Stmt *stmt) {
+    return stmt->getKind() == Kind::ReturnStmt;
+  }
 };
 
 struct Block : public Dumpable {
   SourceLocation location;
-  std::vector<std::unique_ptr<Stmt>> statements;
-  Block(SourceLocation location, std::vector<std::unique_ptr<Stmt>> statements)
-      : location(location), statements(std::move(statements)) {}
+  llvm::ArrayRef<Stmt *> statements;
+  Block(SourceLocation location, llvm::ArrayRef<Stmt *> statements)
+      : location(location), statements(statements) {}
   void dump(size_t level = 0) const override;
 };
 
 struct IfStmt : public Stmt {
-  std::unique_ptr<Expr> condition;
-  std::unique_ptr<Block> trueBlock;
-  std::unique_ptr<Block> falseBlock;
-
-  IfStmt(SourceLocation location, std::unique_ptr<Expr> condition,
-         std::unique_ptr<Block> trueBlock,
-         std::unique_ptr<Block> falseBlock = nullptr)
-      : Stmt(location), condition(std::move(condition)),
-        trueBlock(std::move(trueBlock)), falseBlock(std::move(falseBlock)) {}
+  Expr *condition;
+  Block *trueBlock;
+  Block *falseBlock;
+
+  IfStmt(SourceLocation location, Expr *condition, Block *trueBlock,
+         Block *falseBlock = nullptr)
+      : Stmt(Kind::IfStmt, location), condition(condition),
+        trueBlock(trueBlock), falseBlock(falseBlock) {}
   void dump(size_t level = 0) const override;
+
+  static bool classof(const Stmt *stmt) {
+    return stmt->getKind() == Kind::IfStmt;
+  }
 };
 
 struct WhileStmt : public Stmt {
-  std::unique_ptr<Expr> condition;
-  std::unique_ptr<Block> body;
+  Expr *condition;
+  Block *body;
 
-  WhileStmt(SourceLocation location, std::unique_ptr<Expr> condition,
-            std::unique_ptr<Block> body)
-      : Stmt(location), condition(std::move(condition)), body(std::move(body)) {
-  }
+  WhileStmt(SourceLocation location, Expr *condition, Block *body)
+      : Stmt(Kind::WhileStmt, location), condition(condition), body(body) {}
 
   void dump(size_t level = 0) const override;
+
+  static bool classof(const Stmt *stmt) {
+    return stmt->getKind() == Kind::WhileStmt;
+  }
 };
 
 struct Type {
-  enum class Kind { Void, KwNumber, Number, Custom };
+  // Integer is never parsed: it is a number Sema proved to only hold
+  // integers that double arithmetic computes exactly, see inferIntegers().
+  enum class Kind { Void, KwNumber, Number, Custom, Integer };
   Kind kind;
-  std::string name;
+  Symbol name;
 
-  static Type builtinVoid() { return {Kind::Void, "void"}; }
-  static Type builtinKwNumber() { return {Kind::KwNumber, "number"}; }
-  static Type builtinNumber() { return {Kind::Number, "number"}; }
-  static Type custom(const std::string &name) { return {Kind::Custom, name}; }
+  static Type builtinVoid() { return {Kind::Void, symbols::kwVoid}; }
+  static Type builtinKwNumber() { return {Kind::KwNumber, symbols::kwNumber}; }
+  static Type builtinNumber() { return {Kind::Number, symbols::kwNumber}; }
+  static Type builtinInteger() { return {Kind::Integer, symbols::kwNumber}; }
+  static Type custom(Symbol name) { return {Kind::Custom, name}; }
 
 private:
-  Type(Kind kind, std::string name) : kind(kind), name(std::move(name)){};
+  Type(Kind kind, Symbol name) : kind(kind), name(name){};
 };
 
 struct ParamDecl : public Decl {
   Type type;
-  ParamDecl(SourceLocation location, std::string identifier, Type type)
-      : Decl(location, std::move(identifier)), type(std::move(type)) {}
+  ParamDecl(SourceLocation location, Symbol identifier, Type type)
+      : Decl(Kind::ParamDecl, location, identifier), type(type) {}
   void dump(size_t level = 0) const override;
+
+  static bool classof(const Decl *decl) {
+    return decl->getKind() == Kind::ParamDecl;
+  }
 };
 
 struct FunctionDecl : public Decl {
   Type type;
-  std::unique_ptr<Block> body;
-  std::vector<std::unique_ptr<ParamDecl>> params;
-
-  FunctionDecl(SourceLocation location, std::string identifier, Type type,
-               std::unique_ptr<Block> body,
-               std::vector<std::unique_ptr<ParamDecl>> params)
-      : Decl(location, std::move(identifier)), type(std::move(type)),
-        body(std::move(body)), params(std::move(params)) {}
+  // Null while the body is deferred, see Parser::setLazyBodies().
+  Block *body;
+  llvm::ArrayRef<ParamDecl *> params;
+  // Token range of a deferred body, from its '{' to one past its '}'.
+  uint32_t bodyBegin = 0;
+  uint32_t bodyEnd = 0;
+
+  FunctionDecl(SourceLocation location, Symbol identifier, Type type,
+               Block *body, llvm::ArrayRef<ParamDecl *> params)
+      : Decl(Kind::FunctionDecl, location, identifier), type(type), body(body),
+        params(params) {}
 
   void dump(size_t level = 0) const override;
+
+  static bool classof(const Decl *decl) {
+    return decl->getKind() == Kind::FunctionDecl;
+  }
 };
 
 struct VarDecl : public Decl {
   std::optional<Type> type;
-  std::unique_ptr<Expr> initializer;
+  Expr *initializer;
   bool isMutable;
 
-  VarDecl(SourceLocation location, std::string identifer,
+  VarDecl(SourceLocation location, Symbol identifer,
           std::optional<Type> type, bool isMutable,
-          std::unique_ptr<Expr> initializer = nullptr)
-      : Decl(location, std::move(identifer)), type(std::move(type)),
-        initializer(std::move(initializer)), isMutable(isMutable) {}
+          Expr *initializer = nullptr)
+      : Decl(Kind::VarDecl, location, identifer), type(type),
+        initializer(initializer), isMutable(isMutable) {}
 
   void dump(size_t level = 0) const override;
+
+  static bool classof(const Decl *decl) {
+    return decl->getKind() == Kind::VarDecl;
+  }
 };
 
 struct DeclStmt : public Stmt {
-  std::unique_ptr<VarDecl> varDecl;
+  VarDecl *varDecl;
 
-  DeclStmt(SourceLocation location, std::unique_ptr<VarDecl> varDecl)
-      : Stmt(location), varDecl(std::move(varDecl)) {}
+  DeclStmt(SourceLocation location, VarDecl *varDecl)
+      : Stmt(Kind::DeclStmt, location), varDecl(varDecl) {}
   void dump(size_t level = 0) const override;
+
+  static bool classof(const Stmt *stmt) {
+    return stmt->getKind() == Kind::DeclStmt;
+  }
 };
 
 struct Assignment : public Stmt {
-  std::unique_ptr<DeclRefExpr> variable;
-  std::unique_ptr<Expr> expr;
+  DeclRefExpr *variable;
+  Expr *expr;
 
-  Assignment(SourceLocation location, std::unique_ptr<DeclRefExpr> variable,
-             std::unique_ptr<Expr> expr)
-      : Stmt(location), variable(std::move(variable)), expr(std::move(expr)) {}
+  Assignment(SourceLocation location, DeclRefExpr *variable, Expr *expr)
+      : Stmt(Kind::Assignment, location), variable(variable), expr(expr) {}
 
   void dump(size_t level = 0) const override;
+
+  static bool classof(const Stmt *stmt) {
+    return stmt->getKind() == Kind::Assignment;
+  }
 };
 
 struct BinaryOperator : public Expr {
-  std::unique_ptr<Expr> lhs;
-  std::unique_ptr<Expr> rhs;
+  Expr *lhs;
+  Expr *rhs;
   TokenKind op;
 
-  BinaryOperator(SourceLocation location, std::unique_ptr<Expr> lhs,
-                 std::unique_ptr<Expr> rhs, TokenKind op)
-      : Expr(location), lhs(std::move(lhs)), rhs(std::move(rhs)), op(op) {}
+  BinaryOperator(SourceLocation location, Expr *lhs, Expr *rhs, TokenKind op)
+      : Expr(Kind::BinaryOperator, location), lhs(lhs), rhs(rhs), op(op) {}
 
   void dump(size_t level = 0) const override;
+
+  static bool classof(const Stmt *stmt) {
+    return stmt->getKind() == Kind::BinaryOperator;
+  }
 };
 
 struct UnaryOperator : public Expr {
-  std::unique_ptr<Expr> operand;
+  Expr *operand;
   TokenKind op;
 
-  UnaryOperator(SourceLocation location, std::unique_ptr<Expr> operand,
-                TokenKind op)
-      : Expr(location), operand(std::move(operand)), op(op) {}
+  UnaryOperator(SourceLocation location, Expr *operand, TokenKind op)
+      : Expr(Kind::UnaryOperator, location), operand(operand), op(op) {}
 
   void dump(size_t level = 0) const override;
+
+  static bool classof(const Stmt *stmt) {
+    return stmt->getKind() == Kind::UnaryOperator;
+  }
 };
 
 struct GroupingExpr : public Expr {
-  std::unique_ptr<Expr> expr;
+  Expr *expr;
 
-  GroupingExpr(SourceLocation location, std::unique_ptr<Expr> expr)
-      : Expr(location), expr(std::move(expr)) {}
+  GroupingExpr(SourceLocation location, Expr *expr)
+      : Expr(Kind::GroupingExpr, location), expr(expr) {}
 
   void dump(size_t level = 0) const override;
+
+  static bool classof(const Stmt *stmt) {
+    return stmt->getKind() == Kind::GroupingExpr;
+  }
 };
 
 } // namespace hlx
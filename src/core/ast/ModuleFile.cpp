@@ -0,0 +1,871 @@
+#include "ModuleFile.h"
+#include "../../utils/Interner.h"
+#include "../../utils/SourceManager.h"
+#include "../sema/Effects.h"
+#include "../sema/IntegerInference.h"
+#include <cstring>
+#include <iostream>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/raw_ostream.h>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace hlx {
+namespace {
+constexpr char magic[4] = {'H', 'L', 'X', 'R'};
+
+// Sizes are in elements. Every section starts 8-byte aligned, so the file
+// can be used in place once mapped. Integers are in host byte order.
+struct Section {
+  uint32_t offset;
+  uint32_t size;
+};
+
+struct Header {
+  char magic[4];
+  uint32_t version;
+  uint32_t sourceSize;
+  uint32_t reserved;
+  Section sourcePath;
+  Section lineStarts;
+  Section strings;
+  Section chars;
+  Section constants;
+  Section nodes;
+  Section children;
+  Section functions;
+};
+
+static_assert(sizeof(ModuleFile::Node) == 20, "node layout changed");
+static_assert(sizeof(Header) % 8 == 0, "sections have to stay aligned");
+
+using NodeKind = ModuleFile::NodeKind;
+
+class ModuleWriter {
+  uint32_t base;
+  std::unordered_map<const ResolvedDecl *, uint32_t> declIds;
+  std::unordered_map<const ResolvedFunctionDecl *, uint32_t> functionIds;
+  std::unordered_map<Symbol, uint32_t> stringIds;
+  std::unordered_map<uint32_t, uint32_t> constantIds;
+
+public:
+  std::vector<uint32_t> strings;
+  std::string chars;
+  std::vector<double> constants;
+  std::vector<ModuleFile::Node> nodes;
+  std::vector<uint32_t> children;
+  std::vector<uint32_t> functions;
+
+  explicit ModuleWriter(uint32_t base) : base(base) {}
+
+  void addFunctions(llvm::ArrayRef<ResolvedFunctionDecl *> module);
+
+private:
+  uint32_t addNode(NodeKind kind, SourceLocation location,
+                   llvm::ArrayRef<uint32_t> nodeChildren, uint32_t value = 0,
+                   const Type *type = nullptr,
+                   TokenKind op = TokenKind::Eof,
+                   uint8_t flags = ModuleFile::None);
+  uint32_t addString(Symbol symbol);
+  uint32_t addConstant(uint32_t constant);
+
+  uint32_t flatten(const ResolvedFunctionDecl &fn);
+  uint32_t flatten(const ResolvedBlock &block);
+  uint32_t flatten(const ResolvedStmt &stmt);
+  uint32_t flatten(const ResolvedVarDecl &varDecl);
+  uint32_t flatten(const ResolvedExpr &expr);
+};
+
+uint32_t ModuleWriter::addNode(NodeKind kind, SourceLocation location,
+                               llvm::ArrayRef<uint32_t> nodeChildren,
+                               uint32_t value, const Type *type,
+                               TokenKind op, uint8_t flags) {
+  ModuleFile::Node node;
+  node.kind = kind;
+  // Integer types are inferred again when loading, see toTree().
+  if (type && type->kind == Type::Kind::Integer)
+    type = TypeContext::get().getNumber();
+  node.type = type ? static_cast<uint8_t>(type->kind) : 0;
+  node.flags = flags;
+  node.op = static_cast<char>(op);
+  node.location = location.offset ? location.offset - base + 1 : 0;
+  node.value = value;
+  node.childBegin = children.size();
+  node.childCount = nodeChildren.size();
+
+  nodes.emplace_back(node);
+  children.insert(children.end(), nodeChildren.begin(), nodeChildren.end());
+  return nodes.size() - 1;
+}
+
+uint32_t ModuleWriter::addString(Symbol symbol) {
+  auto [it, inserted] = stringIds.try_emplace(symbol, strings.size() / 2);
+  if (inserted) {
+    std::string_view name = symbol.str();
+    strings.emplace_back(chars.size());
+    strings.emplace_back(name.size());
+    chars.append(name);
+  }
+
+  return it->second;
+}
+
+uint32_t ModuleWriter::addConstant(uint32_t constant) {
+  auto [it, inserted] = constantIds.try_emplace(constant, constants.size());
+  if (inserted)
+    constants.emplace_back(ConstantPool::get().getValue(constant));
+
+  return it->second;
+}
+
+void ModuleWriter::addFunctions(llvm::ArrayRef<ResolvedFunctionDecl *> module) {
+  // Callees are referenced by their index in the function table, so calls
+  // to functions defined later need no fixups.
+  for (auto &&fn : module)
+    functionIds.try_emplace(fn, functionIds.size());
+
+  for (auto &&fn : module)
+    functions.emplace_back(flatten(*fn));
+}
+
+uint32_t ModuleWriter::flatten(const ResolvedFunctionDecl &fn) {
+  std::vector<uint32_t> nodeChildren;
+  for (auto &&param : fn.params) {
+    uint32_t id = addNode(NodeKind::ParamDecl, param->location, {},
+                          addString(param->identifier), param->type);
+    declIds[param] = id;
+    nodeChildren.emplace_back(id);
+  }
+  nodeChildren.emplace_back(flatten(*fn.body));
+
+  return addNode(NodeKind::FunctionDecl, fn.location, nodeChildren,
+                 addString(fn.identifier), fn.type);
+}
+
+uint32_t ModuleWriter::flatten(const ResolvedBlock &block) {
+  std::vector<uint32_t> nodeChildren;
+  for (auto &&stmt : block.statements)
+    nodeChildren.emplace_back(flatten(*stmt));
+
+  return addNode(NodeKind::Block, block.location, nodeChildren);
+}
+
+uint32_t ModuleWriter::flatten(const ResolvedVarDecl &varDecl) {
+  std::vector<uint32_t> nodeChildren;
+  if (varDecl.initializer)
+    nodeChildren.emplace_back(flatten(*varDecl.initializer));
+
+  uint32_t id = addNode(NodeKind::VarDecl, varDecl.location, nodeChildren,
+                        addString(varDecl.identifier), varDecl.type,
+                        TokenKind::Eof,
+                        varDecl.isMutable ? ModuleFile::Mutable
+                                          : ModuleFile::None);
+  declIds[&varDecl] = id;
+  return id;
+}
+
+uint32_t ModuleWriter::flatten(const ResolvedStmt &stmt) {
+  switch (stmt.getKind()) {
+  case ResolvedStmt::Kind::IfStmt: {
+    const auto &ifStmt = llvm::cast<ResolvedIfStmt>(stmt);
+    std::vector<uint32_t> nodeChildren{flatten(*ifStmt.condition),
+                                       flatten(*ifStmt.trueBlock)};
+    if (ifStmt.falseBlock)
+      nodeChildren.emplace_back(flatten(*ifStmt.falseBlock));
+
+    return addNode(NodeKind::IfStmt, stmt.location, nodeChildren);
+  }
+  case ResolvedStmt::Kind::WhileStmt: {
+    const auto &whileStmt = llvm::cast<ResolvedWhileStmt>(stmt);
+    uint32_t condition = flatten(*whileStmt.condition);
+    uint32_t body = flatten(*whileStmt.body);
+    return addNode(NodeKind::WhileStmt, stmt.location, {condition, body});
+  }
+  case ResolvedStmt::Kind::DeclStmt:
+    return addNode(NodeKind::DeclStmt, stmt.location,
+                   {flatten(*llvm::cast<ResolvedDeclStmt>(stmt).varDecl)});
+  case ResolvedStmt::Kind::Assignment: {
+    const auto &assignment = llvm::cast<ResolvedAssignment>(stmt);
+    uint32_t variable = flatten(*assignment.variable);
+    uint32_t expr = flatten(*assignment.expr);
+    return addNode(NodeKind::Assignment, stmt.location, {variable, expr});
+  }
+  case ResolvedStmt::Kind::ReturnStmt: {
+    const auto &returnStmt = llvm::cast<ResolvedReturnStmt>(stmt);
+    if (!returnStmt.expr)
+      return addNode(NodeKind::ReturnStmt, stmt.location, {});
+    return addNode(NodeKind::ReturnStmt, stmt.location,
+                   {flatten(*returnStmt.expr)});
+  }
+  default:
+    return flatten(llvm::cast<ResolvedExpr>(stmt));
+  }
+}
+
+// Walks the expression with an explicit stack, so the depth of the tree is
+// not limited by the call stack. A node is added once all of its children
+// are, which is the post-order the file uses.
+uint32_t ModuleWriter::flatten(const ResolvedExpr &expr) {
+  struct Frame {
+    const ResolvedExpr *expr;
+    // Number of children flattened so far.
+    size_t flattenedChildren = 0;
+  };
+
+  std::vector<Frame> frames{{&expr}};
+  std::vector<uint32_t> ids;
+
+  while (!frames.empty()) {
+    Frame &frame = frames.back();
+    const ResolvedExpr &current = *frame.expr;
+
+    const ResolvedExpr *child = nullptr;
+    switch (current.getKind()) {
+    case ResolvedStmt::Kind::CallExpr: {
+      const auto &call = llvm::cast<ResolvedCallExpr>(current);
+      if (frame.flattenedChildren < call.arguments.size())
+        child = call.arguments[frame.flattenedChildren];
+      break;
+    }
+    case ResolvedStmt::Kind::BinaryOperator: {
+      const auto &binop = llvm::cast<ResolvedBinaryOperator>(current);
+      if (frame.flattenedChildren < 2)
+        child = frame.flattenedChildren == 0 ? binop.lhs : binop.rhs;
+      break;
+    }
+    case ResolvedStmt::Kind::UnaryOperator:
+      if (frame.flattenedChildren == 0)
+        child = llvm::cast<ResolvedUnaryOperator>(current).operand;
+      break;
+    case ResolvedStmt::Kind::GroupingExpr:
+      if (frame.flattenedChildren == 0)
+        child = llvm::cast<ResolvedGroupingExpr>(current).expr;
+      break;
+    default:
+      break;
+    }
+
+    if (child) {
+      ++frame.flattenedChildren;
+      frames.push_back({child});
+      continue;
+    }
+
+    llvm::ArrayRef<uint32_t> nodeChildren =
+        llvm::makeArrayRef(ids).take_back(frame.flattenedChildren);
+    uint32_t id;
+    switch (current.getKind()) {
+    case ResolvedStmt::Kind::NumberLiteral:
+      id = addNode(
+          NodeKind::NumberLiteral, current.location, {},
+          addConstant(llvm::cast<ResolvedNumberLiteral>(current).constant),
+          current.type);
+      break;
+    case ResolvedStmt::Kind::DeclRefExpr:
+      id = addNode(NodeKind::DeclRefExpr, current.location, {},
+                   declIds.at(llvm::cast<ResolvedDeclRefExpr>(current).decl),
+                   current.type);
+      break;
+    case ResolvedStmt::Kind::CallExpr:
+      id = addNode(NodeKind::CallExpr, current.location, nodeChildren,
+                   functionIds.at(llvm::cast<ResolvedCallExpr>(current).callee),
+                   current.type);
+      break;
+    case ResolvedStmt::Kind::BinaryOperator:
+      id = addNode(NodeKind::BinaryOperator, current.location, nodeChildren, 0,
+                   current.type,
+                   llvm::cast<ResolvedBinaryOperator>(current).op);
+      break;
+    case ResolvedStmt::Kind::UnaryOperator:
+      id = addNode(NodeKind::UnaryOperator, current.location, nodeChildren, 0,
+                   current.type, llvm::cast<ResolvedUnaryOperator>(current).op);
+      break;
+    case ResolvedStmt::Kind::GroupingExpr:
+      id = addNode(NodeKind::GroupingExpr, current.location, nodeChildren, 0,
+                   current.type);
+      break;
+    default:
+      llvm_unreachable("unexpected expression");
+    }
+
+    ids.resize(ids.size() - frame.flattenedChildren);
+    ids.emplace_back(id);
+    frames.pop_back();
+  }
+
+  return ids.back();
+}
+
+template <typename T>
+void appendSection(std::string &out, Section &section,
+                   llvm::ArrayRef<T> data) {
+  out.resize((out.size() + 7) & ~size_t(7), '\0');
+  section = {static_cast<uint32_t>(out.size()),
+             static_cast<uint32_t>(data.size())};
+  out.append(reinterpret_cast<const char *>(data.data()),
+             data.size() * sizeof(T));
+}
+
+template <typename T>
+bool getSection(llvm::StringRef file, Section section,
+                llvm::ArrayRef<T> &data) {
+  if (section.offset % alignof(T) != 0 ||
+      uint64_t(section.offset) + uint64_t(section.size) * sizeof(T) >
+          file.size())
+    return false;
+
+  data = llvm::makeArrayRef(
+      reinterpret_cast<const T *>(file.data() + section.offset), section.size);
+  return true;
+}
+
+bool isExpr(NodeKind kind) { return kind >= NodeKind::NumberLiteral; }
+bool isStmt(NodeKind kind) {
+  return kind >= NodeKind::ReturnStmt && kind != NodeKind::VarDecl;
+}
+bool isValidType(uint8_t type) {
+  return type <= static_cast<uint8_t>(Type::Kind::Number);
+}
+
+const Type *getType(const ModuleFile::Node &node) {
+  switch (static_cast<Type::Kind>(node.type)) {
+  case Type::Kind::Void:
+    return TypeContext::get().getVoid();
+  case Type::Kind::KwNumber:
+    return TypeContext::get().get(Type::builtinKwNumber());
+  default:
+    return TypeContext::get().getNumber();
+  }
+}
+} // namespace
+
+bool ModuleFile::write(llvm::ArrayRef<ResolvedFunctionDecl *> module,
+                       const SourceFile &source,
+                       const std::filesystem::path &path) {
+  ModuleWriter writer(SourceManager::get().addFile(source));
+  writer.addFunctions(module);
+
+  std::vector<uint32_t> lineStarts{0};
+  for (size_t i = 0; i < source.buffer.size(); ++i) {
+    if (source.buffer[i] == '\n')
+      lineStarts.emplace_back(i + 1);
+  }
+
+  Header header{};
+  std::memcpy(header.magic, magic, sizeof(magic));
+  header.version = version;
+  header.sourceSize = source.buffer.size();
+
+  std::string out(sizeof(Header), '\0');
+  appendSection<char>(
+      out, header.sourcePath,
+      llvm::makeArrayRef(source.path.data(), source.path.size()));
+  appendSection<uint32_t>(out, header.lineStarts, lineStarts);
+  appendSection<uint32_t>(out, header.strings, writer.strings);
+  appendSection<char>(
+      out, header.chars,
+      llvm::makeArrayRef(writer.chars.data(), writer.chars.size()));
+  appendSection<double>(out, header.constants, writer.constants);
+  appendSection<Node>(out, header.nodes, writer.nodes);
+  appendSection<uint32_t>(out, header.children, writer.children);
+  appendSection<uint32_t>(out, header.functions, writer.functions);
+  std::memcpy(out.data(), &header, sizeof(Header));
+
+  std::error_code errorCode;
+  llvm::raw_fd_ostream file(path.string(), errorCode);
+  if (errorCode)
+    return false;
+
+  file << out;
+  file.close();
+  return !file.has_error();
+}
+
+std::optional<ModuleFile> ModuleFile::open(const std::filesystem::path &path,
+                                           std::string &error) {
+  auto buffer = llvm::MemoryBuffer::getFile(path.string(), /*IsText=*/false,
+                                            /*RequiresNullTerminator=*/false);
+  if (!buffer) {
+    error = "failed to open '" + path.string() +
+            "': " + buffer.getError().message();
+    return std::nullopt;
+  }
+
+  ModuleFile module(std::move(*buffer));
+  llvm::StringRef file = module.buffer->getBuffer();
+
+  Header header;
+  if (file.size() < sizeof(Header) ||
+      std::memcmp(file.data(), magic, sizeof(magic)) != 0) {
+    error = "'" + path.string() + "' is not a resolved module";
+    return std::nullopt;
+  }
+  std::memcpy(&header, file.data(), sizeof(Header));
+
+  if (header.version != version) {
+    error = "'" + path.string() + "' has unsupported version " +
+            std::to_string(header.version);
+    return std::nullopt;
+  }
+
+  llvm::ArrayRef<char> sourcePath;
+  // Mapped files are page aligned, buffers read into memory are 16-byte
+  // aligned.
+  if (reinterpret_cast<uintptr_t>(file.data()) % alignof(double) != 0 ||
+      !getSection(file, header.sourcePath, sourcePath) ||
+      !getSection(file, header.lineStarts, module.lineStarts) ||
+      !getSection(file, header.strings, module.strings) ||
+      !getSection(file, header.chars, module.chars) ||
+      !getSection(file, header.constants, module.constants) ||
+      !getSection(file, header.nodes, module.nodes) ||
+      !getSection(file, header.children, module.children) ||
+      !getSection(file, header.functions, module.functions)) {
+    error = "'" + path.string() + "' is truncated";
+    return std::nullopt;
+  }
+  module.sourcePath = {sourcePath.data(), sourcePath.size()};
+  module.sourceSize = header.sourceSize;
+
+  if (!module.verify(error)) {
+    error = "'" + path.string() + "' is malformed: " + error;
+    return std::nullopt;
+  }
+
+  return module;
+}
+
+// Checks everything toTree() relies on, so a damaged file is rejected
+// instead of building a broken tree: nodes form strict post-order trees,
+// one per function, and every index is in range.
+bool ModuleFile::verify(std::string &error) const {
+  if (lineStarts.empty() || lineStarts[0] != 0) {
+    error = "invalid line table";
+    return false;
+  }
+  for (size_t i = 1; i < lineStarts.size(); ++i) {
+    if (lineStarts[i] <= lineStarts[i - 1] || lineStarts[i] > sourceSize) {
+      error = "invalid line table";
+      return false;
+    }
+  }
+
+  if (strings.size() % 2 != 0) {
+    error = "invalid string table";
+    return false;
+  }
+  for (size_t i = 0; i < strings.size(); i += 2) {
+    if (uint64_t(strings[i]) + strings[i + 1] > chars.size()) {
+      error = "invalid string table";
+      return false;
+    }
+  }
+
+  for (size_t i = 0; i < functions.size(); ++i) {
+    if (functions[i] >= nodes.size() ||
+        (i && functions[i] <= functions[i - 1])) {
+      error = "invalid function table";
+      return false;
+    }
+  }
+  if (!functions.empty() && functions.back() + 1 != nodes.size()) {
+    error = "invalid function table";
+    return false;
+  }
+
+  std::vector<uint32_t> subtreeBegins(nodes.size());
+  size_t fnIdx = 0;
+  for (uint32_t id = 0; id < nodes.size(); ++id) {
+    const Node &node = nodes[id];
+    if (node.kind > NodeKind::GroupingExpr ||
+        uint64_t(node.childBegin) + node.childCount > children.size() ||
+        node.location > uint64_t(sourceSize) + 1) {
+      error = "invalid node " + std::to_string(id);
+      return false;
+    }
+
+    // The children of a node are the subtrees directly preceding it.
+    llvm::ArrayRef<uint32_t> nodeChildren = getChildren(id);
+    uint32_t next = id;
+    for (auto it = nodeChildren.rbegin(); it != nodeChildren.rend(); ++it) {
+      if (*it + 1 != next) {
+        error = "node " + std::to_string(id) + " is not in post-order";
+        return false;
+      }
+      next = subtreeBegins[*it];
+    }
+    subtreeBegins[id] = next;
+
+    while (fnIdx < functions.size() && functions[fnIdx] < id)
+      ++fnIdx;
+    if (fnIdx == functions.size()) {
+      error = "node " + std::to_string(id) + " is outside of any function";
+      return false;
+    }
+    uint32_t fnBegin = fnIdx ? functions[fnIdx - 1] + 1 : 0;
+
+    auto childKind = [&](size_t i) { return nodes[nodeChildren[i]].kind; };
+    // Types of expressions are checked when they are visited, so a child
+    // can be trusted to produce a value if its type is not void.
+    auto isValue = [&](size_t i) {
+      return isExpr(childKind(i)) &&
+             nodes[nodeChildren[i]].type !=
+                 static_cast<uint8_t>(Type::Kind::Void);
+    };
+    auto allValues = [&]() {
+      for (size_t i = 0; i < nodeChildren.size(); ++i) {
+        if (!isValue(i))
+          return false;
+      }
+      return true;
+    };
+    auto hasValueType = [&](const Node &decl) {
+      return isValidType(decl.type) &&
+             decl.type != static_cast<uint8_t>(Type::Kind::Void);
+    };
+    size_t childCount = nodeChildren.size();
+
+    bool valid = false;
+    switch (node.kind) {
+    case NodeKind::FunctionDecl:
+      valid = id == functions[fnIdx] && next == fnBegin && childCount >= 1 &&
+              childKind(childCount - 1) == NodeKind::Block &&
+              node.value < strings.size() / 2 && isValidType(node.type);
+      for (size_t i = 0; valid && i + 1 < childCount; ++i)
+        valid = childKind(i) == NodeKind::ParamDecl;
+      break;
+    case NodeKind::ParamDecl:
+      valid = childCount == 0 && node.value < strings.size() / 2 &&
+              hasValueType(node);
+      break;
+    case NodeKind::Block:
+      valid = true;
+      for (size_t i = 0; valid && i < childCount; ++i)
+        valid = isStmt(childKind(i));
+      break;
+    case NodeKind::ReturnStmt: {
+      bool isVoid = nodes[functions[fnIdx]].type ==
+                    static_cast<uint8_t>(Type::Kind::Void);
+      valid = childCount == (isVoid ? 0 : 1) && allValues();
+      break;
+    }
+    case NodeKind::IfStmt:
+      valid = (childCount == 2 || childCount == 3) && isValue(0) &&
+              childKind(1) == NodeKind::Block &&
+              (childCount == 2 || childKind(2) == NodeKind::Block);
+      break;
+    case NodeKind::WhileStmt:
+      valid = childCount == 2 && isValue(0) &&
+              childKind(1) == NodeKind::Block;
+      break;
+    case NodeKind::DeclStmt:
+      valid = childCount == 1 && childKind(0) == NodeKind::VarDecl;
+      break;
+    case NodeKind::VarDecl:
+      valid = childCount <= 1 && allValues() &&
+              node.value < strings.size() / 2 && hasValueType(node);
+      break;
+    case NodeKind::Assignment:
+      valid = childCount == 2 && childKind(0) == NodeKind::DeclRefExpr &&
+              isValue(1);
+      break;
+    case NodeKind::NumberLiteral:
+      valid = childCount == 0 && node.value < constants.size() &&
+              node.type == static_cast<uint8_t>(Type::Kind::Number);
+      break;
+    case NodeKind::DeclRefExpr:
+      valid = childCount == 0 && node.value >= fnBegin && node.value < id &&
+              (nodes[node.value].kind == NodeKind::ParamDecl ||
+               nodes[node.value].kind == NodeKind::VarDecl) &&
+              node.type == nodes[node.value].type;
+      break;
+    case NodeKind::CallExpr:
+      valid = node.value < functions.size() && allValues() &&
+              childCount + 1 == nodes[functions[node.value]].childCount &&
+              node.type == nodes[functions[node.value]].type;
+      break;
+    case NodeKind::BinaryOperator:
+      switch (static_cast<TokenKind>(node.op)) {
+      case TokenKind::Plus:
+      case TokenKind::Minus:
+      case TokenKind::Asterisk:
+      case TokenKind::Slash:
+      case TokenKind::Mod:
+      case TokenKind::Lt:
+      case TokenKind::Gt:
+      case TokenKind::LessThanEql:
+      case TokenKind::MoreThanEql:
+      case TokenKind::EqualEqual:
+      case TokenKind::NotEqual:
+      case TokenKind::AmpAmp:
+      case TokenKind::PipePipe:
+        valid = childCount == 2 && allValues() &&
+                node.type == nodes[nodeChildren[0]].type;
+        break;
+      default:
+        break;
+      }
+      break;
+    case NodeKind::UnaryOperator:
+      valid = childCount == 1 && allValues() &&
+              node.type == nodes[nodeChildren[0]].type &&
+              (node.op == static_cast<char>(TokenKind::Minus) ||
+               node.op == static_cast<char>(TokenKind::Excl));
+      break;
+    case NodeKind::GroupingExpr:
+      valid = childCount == 1 && isExpr(childKind(0)) &&
+              node.type == nodes[nodeChildren[0]].type;
+      break;
+    }
+
+    if (!valid) {
+      error = "invalid node " + std::to_string(id);
+      return false;
+    }
+  }
+
+  // Codegen looks functions up by name and gives main and println special
+  // treatment, like sema guarantees for sources.
+  std::unordered_set<std::string_view> names;
+  for (auto &&fn : functions) {
+    const Node &node = nodes[fn];
+    std::string_view name = getString(node.value);
+    bool valid = names.insert(name).second;
+    bool isVoid = node.type == static_cast<uint8_t>(Type::Kind::Void);
+    if (name == "main")
+      valid &= isVoid && node.childCount == 1;
+    if (name == "println")
+      valid &= isVoid && node.childCount == 2;
+
+    if (!valid) {
+      error = "invalid function '" + std::string(name) + "'";
+      return false;
+    }
+  }
+
+  return true;
+}
+
+std::vector<ResolvedFunctionDecl *> ModuleFile::toTree(Arena &arena) const {
+  uint32_t base = SourceManager::get().addFile(
+      sourcePath, sourceSize, {lineStarts.begin(), lineStarts.end()});
+  auto getLocation = [&](const Node &node) {
+    return SourceLocation{node.location ? base + node.location - 1 : 0};
+  };
+
+  std::vector<Symbol> symbols;
+  for (size_t i = 0; i < strings.size() / 2; ++i)
+    symbols.emplace_back(Interner::get().intern(getString(i)));
+
+  std::vector<uint32_t> constantIds;
+  for (auto &&constant : constants)
+    constantIds.emplace_back(ConstantPool::get().intern(constant));
+
+  struct Built {
+    ResolvedStmt *stmt = nullptr;
+    ResolvedBlock *block = nullptr;
+    ResolvedDecl *decl = nullptr;
+  };
+  std::vector<Built> built(nodes.size());
+
+  // Signatures first, calls may refer to functions defined later.
+  std::vector<ResolvedFunctionDecl *> module;
+  for (auto &&fn : functions) {
+    std::vector<ResolvedParamDecl *> params;
+    for (auto &&param : getChildren(fn).drop_back()) {
+      const Node &node = nodes[param];
+      params.emplace_back(arena.make<ResolvedParamDecl>(
+          getLocation(node), symbols[node.value], getType(node)));
+      built[param].decl = params.back();
+    }
+
+    const Node &node = nodes[fn];
+    module.emplace_back(arena.make<ResolvedFunctionDecl>(
+        getLocation(node), symbols[node.value], getType(node),
+        arena.copyArray(params), nullptr));
+    built[fn].decl = module.back();
+  }
+
+  // Effects are not stored, they are inferred again from the call graph.
+  std::vector<std::vector<const ResolvedFunctionDecl *>> callees(
+      module.size());
+  std::vector<char> loops(module.size());
+  size_t fnIdx = 0;
+
+  // Children precede their parents, so a single pass builds the bodies.
+  for (uint32_t id = 0; id < nodes.size(); ++id) {
+    const Node &node = nodes[id];
+    if (id > functions[fnIdx])
+      ++fnIdx;
+    llvm::ArrayRef<uint32_t> nodeChildren = getChildren(id);
+    SourceLocation location = getLocation(node);
+    auto expr = [&](size_t i) {
+      return llvm::cast<ResolvedExpr>(built[nodeChildren[i]].stmt);
+    };
+    auto block = [&](size_t i) { return built[nodeChildren[i]].block; };
+
+    switch (node.kind) {
+    case NodeKind::FunctionDecl:
+      llvm::cast<ResolvedFunctionDecl>(built[id].decl)->body =
+          block(nodeChildren.size() - 1);
+      break;
+    case NodeKind::ParamDecl:
+      break;
+    case NodeKind::Block: {
+      std::vector<ResolvedStmt *> statements;
+      for (auto &&stmt : nodeChildren)
+        statements.emplace_back(built[stmt].stmt);
+
+      built[id].block =
+          arena.make<ResolvedBlock>(location, arena.copyArray(statements));
+      break;
+    }
+    case NodeKind::ReturnStmt:
+      built[id].stmt = arena.make<ResolvedReturnStmt>(
+          location, nodeChildren.empty() ? nullptr : expr(0));
+      break;
+    case NodeKind::IfStmt:
+      built[id].stmt = arena.make<ResolvedIfStmt>(
+          location, expr(0), block(1),
+          nodeChildren.size() > 2 ? block(2) : nullptr);
+      break;
+    case NodeKind::WhileStmt:
+      built[id].stmt =
+          arena.make<ResolvedWhileStmt>(location, expr(0), block(1));
+      loops[fnIdx] = true;
+      break;
+    case NodeKind::DeclStmt:
+      built[id].stmt = arena.make<ResolvedDeclStmt>(
+          location, llvm::cast<ResolvedVarDecl>(built[nodeChildren[0]].decl));
+      break;
+    case NodeKind::VarDecl:
+      built[id].decl = arena.make<ResolvedVarDecl>(
+          location, symbols[node.value], getType(node), node.flags & Mutable,
+          nodeChildren.empty() ? nullptr : expr(0));
+      break;
+    case NodeKind::Assignment:
+      built[id].stmt = arena.make<ResolvedAssignment>(
+          location,
+          llvm::cast<ResolvedDeclRefExpr>(built[nodeChildren[0]].stmt),
+          expr(1));
+      break;
+    case NodeKind::NumberLiteral:
+      built[id].stmt = arena.make<ResolvedNumberLiteral>(
+          location, constantIds[node.value], getConstant(node.value));
+      break;
+    case NodeKind::DeclRefExpr:
+      built[id].stmt = arena.make<ResolvedDeclRefExpr>(
+          location, *built[node.value].decl);
+      break;
+    case NodeKind::CallExpr: {
+      std::vector<ResolvedExpr *> arguments;
+      for (size_t i = 0; i < nodeChildren.size(); ++i)
+        arguments.emplace_back(expr(i));
+
+      built[id].stmt = arena.make<ResolvedCallExpr>(
+          location,
+          *llvm::cast<ResolvedFunctionDecl>(
+              built[functions[node.value]].decl),
+          arena.copyArray(arguments));
+      callees[fnIdx].emplace_back(module[node.value]);
+      break;
+    }
+    case NodeKind::BinaryOperator:
+      built[id].stmt = arena.make<ResolvedBinaryOperator>(
+          location, static_cast<TokenKind>(node.op), expr(0), expr(1));
+      break;
+    case NodeKind::UnaryOperator:
+      built[id].stmt = arena.make<ResolvedUnaryOperator>(
+          location, static_cast<TokenKind>(node.op), expr(0));
+      break;
+    case NodeKind::GroupingExpr:
+      built[id].stmt = arena.make<ResolvedGroupingExpr>(location, expr(0));
+      break;
+    }
+  }
+
+  inferEffects(module, callees, loops);
+  for (auto &&fn : module)
+    inferIntegers(*fn);
+  return module;
+}
+
+// Walks the records with an explicit stack instead of building the tree,
+// so dumping a module costs no more than reading it.
+void ModuleFile::dump() const {
+  std::vector<std::pair<uint32_t, size_t>> pending;
+  for (auto it = functions.rbegin(); it != functions.rend(); ++it)
+    pending.emplace_back(*it, 0);
+
+  while (!pending.empty()) {
+    auto [id, level] = pending.back();
+    pending.pop_back();
+    const Node &node = nodes[id];
+    auto address = [&](uint32_t decl) {
+      return static_cast<const void *>(&nodes[decl]);
+    };
+
+    std::cerr << std::string(level * 2, ' ');
+    switch (node.kind) {
+    case NodeKind::FunctionDecl:
+      std::cerr << "ResolvedFunctionDecl: @(" << address(id) << ") "
+                << getString(node.value) << ":\n";
+      break;
+    case NodeKind::ParamDecl:
+      std::cerr << "ResolvedParamDecl: @(" << address(id) << ") "
+                << getString(node.value) << ":\n";
+      break;
+    case NodeKind::Block:
+      std::cerr << "ResolvedBlock\n";
+      break;
+    case NodeKind::ReturnStmt:
+      std::cerr << "ResolvedReturnStmt\n";
+      break;
+    case NodeKind::IfStmt:
+      std::cerr << "ResolvedIfStmt:\n";
+      break;
+    case NodeKind::WhileStmt:
+      std::cerr << "ResolvedWhileStmt\n";
+      break;
+    case NodeKind::DeclStmt:
+      std::cerr << "ResolvedDeclStmt:\n";
+      break;
+    case NodeKind::VarDecl:
+      std::cerr << "ResolvedVarDecl: @(" << address(id) << ") "
+                << getString(node.value) << ":\n";
+      break;
+    case NodeKind::Assignment:
+      std::cerr << "ResolvedAssignment:\n";
+      break;
+    case NodeKind::NumberLiteral:
+      std::cerr << "ResolvedNumberLiteral: '" << getConstant(node.value)
+                << "'\n";
+      break;
+    case NodeKind::DeclRefExpr:
+      std::cerr << "ResolvedDeclRefExpr: @(" << address(node.value) << ") "
+                << getString(nodes[node.value].value) << '\n';
+      break;
+    case NodeKind::CallExpr: {
+      uint32_t callee = functions[node.value];
+      std::cerr << "ResolvedCallExpr: @(" << address(callee) << ") "
+                << getString(nodes[callee].value) << '\n';
+      break;
+    }
+    case NodeKind::BinaryOperator:
+      std::cerr << "ResolvedBinaryOperator: '"
+                << getOpStr(static_cast<TokenKind>(node.op)) << "'\n";
+      break;
+    case NodeKind::UnaryOperator:
+      std::cerr << "ResolvedUnaryOperator: '"
+                << getOpStr(static_cast<TokenKind>(node.op)) << "'\n";
+      break;
+    case NodeKind::GroupingExpr:
+      std::cerr << "ResolvedGroupingExpr:\n";
+      break;
+    }
+
+    llvm::ArrayRef<uint32_t> nodeChildren = getChildren(id);
+    for (auto it = nodeChildren.rbegin(); it != nodeChildren.rend(); ++it)
+      pending.emplace_back(*it, level + 1);
+  }
+}
+} // namespace hlx
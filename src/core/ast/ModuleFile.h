@@ -0,0 +1,134 @@
+#pragma once
+
+#include "../../utils/Arena.h"
+#include "ResolvedAst.h"
+#include <cstdint>
+#include <filesystem>
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hlx {
+// Versioned binary form of a resolved module (.hlxr), written with -emit-res
+// and accepted instead of a source file. The file is a header followed by
+// flat sections. Opening it maps the file and checks it once, after which
+// the accessors and dump() read the records in place.
+//
+// Code generation is not one of those readers: it needs the resolved tree,
+// which toTree() builds in full, interning every name and constant and
+// inferring effects and integer types again. Compiling a loaded module thus
+// still pays for one pass over every node, about a fifth of the time
+// resolving its source takes, only the lexer, parser and sema are saved.
+//
+// Nodes are numbered in post-order, so children precede their parent and a
+// subtree is a contiguous range of records. Names and constants are
+// indices into the module's own string and constant tables, decl references
+// are node indices and callees are indices into the function table.
+// Locations are offsets into the original source, whose line table is
+// stored so diagnostics still decode to file:line:col.
+class ModuleFile {
+public:
+  static constexpr uint32_t version = 1;
+
+  enum class NodeKind : uint8_t {
+    FunctionDecl,
+    ParamDecl,
+    Block,
+    ReturnStmt,
+    IfStmt,
+    WhileStmt,
+    DeclStmt,
+    VarDecl,
+    Assignment,
+    NumberLiteral,
+    DeclRefExpr,
+    CallExpr,
+    BinaryOperator,
+    UnaryOperator,
+    GroupingExpr,
+  };
+
+  // Node layout:
+  //   FunctionDecl    value: name, type, children: params..., body
+  //   ParamDecl       value: name, type
+  //   Block           children: statements...
+  //   ReturnStmt      children: [expr]
+  //   IfStmt          children: condition, trueBlock, [falseBlock]
+  //   WhileStmt       children: condition, body
+  //   DeclStmt        children: varDecl
+  //   VarDecl         value: name, type, flags, children: [init]
+  //   Assignment      children: variable, expr
+  //   NumberLiteral   value: constant, type
+  //   DeclRefExpr     value: decl node, type
+  //   CallExpr        value: callee function, type, children: arguments...
+  //   BinaryOperator  op, type, children: lhs, rhs
+  //   UnaryOperator   op, type, children: operand
+  //   GroupingExpr    type, children: expr
+  enum Flags : uint8_t { None = 0, Mutable = 1 };
+
+  struct Node {
+    NodeKind kind;
+    // Type::Kind of decls and expressions.
+    uint8_t type;
+    uint8_t flags;
+    // TokenKind of operators.
+    char op;
+    // Offset into the source plus one, 0 for builtins.
+    uint32_t location;
+    uint32_t value;
+    uint32_t childBegin;
+    uint32_t childCount;
+  };
+
+private:
+  std::unique_ptr<llvm::MemoryBuffer> buffer;
+
+  std::string_view sourcePath;
+  uint32_t sourceSize = 0;
+  llvm::ArrayRef<uint32_t> lineStarts;
+  // Pairs of offset and size into 'chars'.
+  llvm::ArrayRef<uint32_t> strings;
+  llvm::ArrayRef<char> chars;
+  llvm::ArrayRef<double> constants;
+  llvm::ArrayRef<Node> nodes;
+  llvm::ArrayRef<uint32_t> children;
+  llvm::ArrayRef<uint32_t> functions;
+
+  explicit ModuleFile(std::unique_ptr<llvm::MemoryBuffer> buffer)
+      : buffer(std::move(buffer)) {}
+
+  bool verify(std::string &error) const;
+
+public:
+  // Serializes 'module', resolved from 'source', to 'path'.
+  static bool write(llvm::ArrayRef<ResolvedFunctionDecl *> module,
+                    const SourceFile &source,
+                    const std::filesystem::path &path);
+  // Maps the module at 'path'. On failure 'error' describes the problem.
+  static std::optional<ModuleFile> open(const std::filesystem::path &path,
+                                        std::string &error);
+
+  // Builds the resolved tree in 'arena'. Names and constants are interned
+  // and the source is registered with the SourceManager, which keeps
+  // referring to the path stored in this file.
+  std::vector<ResolvedFunctionDecl *> toTree(Arena &arena) const;
+  // Prints what dump() prints for the tree toTree() builds, with the
+  // addresses of the records standing in for those of the decls.
+  void dump() const;
+
+  std::string_view getSourcePath() const { return sourcePath; }
+  llvm::ArrayRef<uint32_t> getFunctions() const { return functions; }
+  const Node &getNode(uint32_t id) const { return nodes[id]; }
+  llvm::ArrayRef<uint32_t> getChildren(uint32_t id) const {
+    return children.slice(nodes[id].childBegin, nodes[id].childCount);
+  }
+  std::string_view getString(uint32_t idx) const {
+    return {chars.data() + strings[2 * idx], strings[2 * idx + 1]};
+  }
+  double getConstant(uint32_t idx) const { return constants[idx]; }
+};
+} // namespace hlx
@@ -3,7 +3,8 @@
 #include <cstddef>
 #include <iostream>
 void hlx::ResolvedNumberLiteral::dump(size_t level) const {
-    std::cerr << indent(level) << "ResolvedNumberLiteral: '" << value << "'\n";
+    std::cerr << indent(level) << "ResolvedNumberLiteral: '"
+              << value << "'\n";
 }
 
 void hlx::ResolvedDeclRefExpr::dump(size_t level) const {
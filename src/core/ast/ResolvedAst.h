@@ -1,225 +1,327 @@
 #pragma once
 #include "Ast.h"
+#include "TypeContext.h"
 #include <cstddef>
-#include <memory>
 #include <utility>
 namespace hlx{
-    
+
+// Like the AST, resolved nodes live in an Arena and are never destroyed,
+// and carry a Kind for switch dispatch and llvm::isa/cast/dyn_cast.
 struct ResolvedStmt:public Dumpable {
+  enum class Kind {
+    ReturnStmt,
+    IfStmt,
+    WhileStmt,
+    DeclStmt,
+    Assignment,
+
+    NumberLiteral,
+    DeclRefExpr,
+    CallExpr,
+    BinaryOperator,
+    UnaryOperator,
+    GroupingExpr,
+
+    FirstExpr = NumberLiteral,
+    LastExpr = GroupingExpr
+  };
+
+  const Kind kind;
   SourceLocation location;
 
-  ResolvedStmt(SourceLocation location) : location(location) {}
+  ResolvedStmt(Kind kind, SourceLocation location)
+      : kind(kind), location(location) {}
 
   virtual ~ResolvedStmt() = default;
   virtual void dump(size_t level = 0) const = 0;
+  Kind getKind() const { return kind; }
 };
 
 struct ResolvedExpr : public ResolvedStmt {
-  Type type;
+  // Owned by the TypeContext.
+  const Type *type;
+
+  ResolvedExpr(Kind kind, SourceLocation location, const Type *type)
+      : ResolvedStmt(kind, location), type(type) {}
 
-  ResolvedExpr(SourceLocation location, Type type)
-      : ResolvedStmt(location), type(type) {}
+  static bool classof(const ResolvedStmt *stmt) {
+    return stmt->getKind() >= Kind::FirstExpr &&
+           stmt->getKind() <= Kind::LastExpr;
+  }
 };
 
 struct ResolvedDecl {
+  enum class Kind { ParamDecl, FunctionDecl, VarDecl };
+
+  const Kind kind;
   SourceLocation location;
-  std::string identifier;
-  Type type;
+  Symbol identifier;
+  // Owned by the TypeContext.
+  const Type *type;
 
-  ResolvedDecl(SourceLocation location, std::string identifier, Type type)
-      : location(location), identifier(std::move(identifier)), type(type) {}
+  ResolvedDecl(Kind kind, SourceLocation location, Symbol identifier,
+               const Type *type)
+      : kind(kind), location(location), identifier(identifier), type(type) {}
 
   virtual ~ResolvedDecl() = default;
 
   virtual void dump(size_t level = 0) const = 0;
+  Kind getKind() const { return kind; }
 };
 
 
 
 struct ResolvedNumberLiteral : public ResolvedExpr {
+  // Index into the ConstantPool. The value is kept as well, so constants
+  // folded by a Sema worker can be read before they are pooled.
+  uint32_t constant;
   double value;
-  ResolvedNumberLiteral(SourceLocation location, double value)
-      : ResolvedExpr(location, Type::builtinNumber()), value(value) {}
+  ResolvedNumberLiteral(SourceLocation location, uint32_t constant,
+                        double value)
+      : ResolvedExpr(Kind::NumberLiteral, location,
+                     TypeContext::get().getNumber()),
+        constant(constant), value(value) {}
 
   void dump(size_t level = 0) const override;
   std::string indent(size_t level) const { return std::string(level * 2, ' '); }
+
+  static bool classof(const ResolvedStmt *stmt) {
+    return stmt->getKind() == Kind::NumberLiteral;
+  }
 };
 
 struct ResolvedDeclRefExpr : public ResolvedExpr {
   const ResolvedDecl *decl;
   ResolvedDeclRefExpr(SourceLocation location, ResolvedDecl &decl)
-      : ResolvedExpr(location, decl.type), decl(&decl) {}
+      : ResolvedExpr(Kind::DeclRefExpr, location, decl.type), decl(&decl) {}
 
   void dump(size_t level = 0) const override;
   std::string indent(size_t level) const { return std::string(level * 2, ' '); }
+
+  static bool classof(const ResolvedStmt *stmt) {
+    return stmt->getKind() == Kind::DeclRefExpr;
+  }
 };
 
 struct ResolvedBlock {
   SourceLocation location;
-  std::vector<std::unique_ptr<ResolvedStmt>> statements;
+  llvm::ArrayRef<ResolvedStmt *> statements;
 
   ResolvedBlock(SourceLocation location,
-                std::vector<std::unique_ptr<ResolvedStmt>> statements)
-      : location(location), statements(std::move(statements)) {}
+                llvm::ArrayRef<ResolvedStmt *> statements)
+      : location(location), statements(statements) {}
   void dump(size_t level = 0) const;
   std::string indent(size_t level) const { return std::string(level * 2, ' '); }
 };
 
 struct ResolvedParamDecl : public ResolvedDecl {
-  ResolvedParamDecl(SourceLocation location, std::string identifier, Type type)
-      : ResolvedDecl(location, identifier, type) {}
+  ResolvedParamDecl(SourceLocation location, Symbol identifier,
+                    const Type *type)
+      : ResolvedDecl(Kind::ParamDecl, location, identifier, type) {}
   void dump(size_t level = 0) const;
   std::string indent(size_t level) const { return std::string(level * 2, ' '); }
+
+  static bool classof(const ResolvedDecl *decl) {
+    return decl->getKind() == Kind::ParamDecl;
+  }
 };
 
 struct ResolvedFunctionDecl : public ResolvedDecl {
-  std::vector<std::unique_ptr<ResolvedParamDecl>> params;
-  std::unique_ptr<ResolvedBlock> body;
-
-  ResolvedFunctionDecl(SourceLocation location, std::string identifier,
-                       Type type,
-                       std::vector<std::unique_ptr<ResolvedParamDecl>> params,
-                       std::unique_ptr<ResolvedBlock> body)
-      : ResolvedDecl(location, std::move(identifier), type),
-        params(std::move(params)), body(std::move(body)) {}
+  llvm::ArrayRef<ResolvedParamDecl *> params;
+  ResolvedBlock *body;
+  // Effects, see inferEffects() in sema/Effects.h. Never prints, not even
+  // through a callee.
+  bool isPure = false;
+  // Returns on every path: no loops and no recursion, and every callee
+  // returns as well.
+  bool willReturn = false;
+
+  ResolvedFunctionDecl(SourceLocation location, Symbol identifier,
+                       const Type *type, llvm::ArrayRef<ResolvedParamDecl *> params,
+                       ResolvedBlock *body)
+      : ResolvedDecl(Kind::FunctionDecl, location, identifier, type),
+        params(params), body(body) {}
   void dump(size_t level = 0) const override;
   std::string indent(size_t level) const { return std::string(level * 2, ' '); }
+
+  static bool classof(const ResolvedDecl *decl) {
+    return decl->getKind() == Kind::FunctionDecl;
+  }
 };
 
 struct ResolvedCallExpr : public ResolvedExpr {
   const ResolvedFunctionDecl *callee;
-  std::vector<std::unique_ptr<ResolvedExpr>> arguments;
+  llvm::ArrayRef<ResolvedExpr *> arguments;
 
   ResolvedCallExpr(SourceLocation location, const ResolvedFunctionDecl &callee,
-                   std::vector<std::unique_ptr<ResolvedExpr>> arguments)
-      : ResolvedExpr(location, callee.type), callee(&callee),
-        arguments(std::move(arguments)) {}
+                   llvm::ArrayRef<ResolvedExpr *> arguments)
+      : ResolvedExpr(Kind::CallExpr, location, callee.type), callee(&callee),
+        arguments(arguments) {}
   void dump(size_t level = 0) const override;
   std::string indent(size_t level) const { return std::string(level * 2, ' '); }
+
+  static bool classof(const ResolvedStmt *stmt) {
+    return stmt->getKind() == Kind::CallExpr;
+  }
 };
 
 struct ResolvedReturnStmt : public ResolvedStmt {
-  std::unique_ptr<ResolvedExpr> expr;
+  ResolvedExpr *expr;
 
-  ResolvedReturnStmt(SourceLocation location,
-                     std::unique_ptr<ResolvedExpr> expr = nullptr)
-      : ResolvedStmt(location), expr(std::move(expr)) {}
+  ResolvedReturnStmt(SourceLocation location, ResolvedExpr *expr = nullptr)
+      : ResolvedStmt(Kind::ReturnStmt, location), expr(expr) {}
   void dump(size_t level = 0) const override;
   std::string indent(size_t level) const { return std::string(level * 2, ' '); }
+
+  static bool classof(const ResolvedStmt *stmt) {
+    return stmt->getKind() == Kind::ReturnStmt;
+  }
 };
 
 struct ResolvedBinaryOperator:public ResolvedExpr{
   TokenKind op;
-  std::unique_ptr<ResolvedExpr> lhs;
-  std::unique_ptr<ResolvedExpr> rhs;
+  ResolvedExpr *lhs;
+  ResolvedExpr *rhs;
 
   ResolvedBinaryOperator(SourceLocation location,
                           TokenKind op,
-                          std::unique_ptr<ResolvedExpr> lhs,
-                          std::unique_ptr<ResolvedExpr> rhs)
-                          : ResolvedExpr(location, lhs->type),
+                          ResolvedExpr *lhs,
+                          ResolvedExpr *rhs)
+                          : ResolvedExpr(Kind::BinaryOperator, location, lhs->type),
                           op(op),
-                          lhs(std::move(lhs)),
-                          rhs(std::move(rhs)){}
+                          lhs(lhs),
+                          rhs(rhs){}
   
   void dump(size_t level=0)const override;
+
+  static bool classof(const ResolvedStmt *stmt) {
+    return stmt->getKind() == Kind::BinaryOperator;
+  }
 };
 
 struct ResolvedUnaryOperator:public ResolvedExpr{
   TokenKind op;
-  std::unique_ptr<ResolvedExpr> operand;
+  ResolvedExpr *operand;
 
   ResolvedUnaryOperator(SourceLocation location,
                         TokenKind op,
-                        std::unique_ptr<ResolvedExpr> operand)
-                        : ResolvedExpr(location,operand->type),
+                        ResolvedExpr *operand)
+                        : ResolvedExpr(Kind::UnaryOperator, location,operand->type),
                         op(op),
-                        operand(std::move(operand)){}
+                        operand(operand){}
   
   void dump(size_t level=0)const override;
+
+  static bool classof(const ResolvedStmt *stmt) {
+    return stmt->getKind() == Kind::UnaryOperator;
+  }
 };
 
 struct ResolvedGroupingExpr:public ResolvedExpr{
-  std::unique_ptr<ResolvedExpr> expr;
+  ResolvedExpr *expr;
 
   ResolvedGroupingExpr(SourceLocation location,
-                        std::unique_ptr<ResolvedExpr> expr)
-                        :ResolvedExpr(location, expr->type),
-                        expr(std::move(expr)){}
+                        ResolvedExpr *expr)
+                        :ResolvedExpr(Kind::GroupingExpr, location, expr->type),
+                        expr(expr){}
   
   void dump(size_t level=0)const override;
+
+  static bool classof(const ResolvedStmt *stmt) {
+    return stmt->getKind() == Kind::GroupingExpr;
+  }
 };
 
 struct ResolvedIfStmt:public ResolvedStmt{
-  std::unique_ptr<ResolvedExpr> condition;
-  std::unique_ptr<ResolvedBlock> trueBlock;
-  std::unique_ptr<ResolvedBlock> falseBlock;
+  ResolvedExpr *condition;
+  ResolvedBlock *trueBlock;
+  ResolvedBlock *falseBlock;
 
   ResolvedIfStmt(SourceLocation location,
-                  std::unique_ptr<ResolvedExpr> condition,
-                  std::unique_ptr<ResolvedBlock> trueBlock,
-                  std::unique_ptr<ResolvedBlock> falseBlock=nullptr)
-                  : ResolvedStmt(location),
-                  condition(std::move(condition)),
-                  trueBlock(std::move(trueBlock)),
-                  falseBlock(std::move(falseBlock)){}
+                  ResolvedExpr *condition,
+                  ResolvedBlock *trueBlock,
+                  ResolvedBlock *falseBlock=nullptr)
+                  : ResolvedStmt(Kind::IfStmt, location),
+                  condition(condition),
+                  trueBlock(trueBlock),
+                  falseBlock(falseBlock){}
   void dump(size_t level = 0) const override;
+
+  static bool classof(const ResolvedStmt *stmt) {
+    return stmt->getKind() == Kind::IfStmt;
+  }
 };
 
 struct ResolvedWhileStmt:public ResolvedStmt{
-  std::unique_ptr<ResolvedExpr> condition;
-  std::unique_ptr<ResolvedBlock> body;
+  ResolvedExpr *condition;
+  ResolvedBlock *body;
 
   ResolvedWhileStmt(SourceLocation location,
-                    std::unique_ptr<ResolvedExpr> condition,
-                    std::unique_ptr<ResolvedBlock> body)
-                    :ResolvedStmt(location),
-                    condition(std::move(condition)),
-                    body(std::move(body)){}
+                    ResolvedExpr *condition,
+                    ResolvedBlock *body)
+                    :ResolvedStmt(Kind::WhileStmt, location),
+                    condition(condition),
+                    body(body){}
   
   void dump(size_t level=0)const override;
+
+  static bool classof(const ResolvedStmt *stmt) {
+    return stmt->getKind() == Kind::WhileStmt;
+  }
 };
 
 struct ResolvedVarDecl:public ResolvedDecl{
-  std::unique_ptr<ResolvedExpr> initializer;
+  ResolvedExpr *initializer;
   bool isMutable;
 
   ResolvedVarDecl(SourceLocation location,
-                  std::string identifier,
-                  Type type,
+                  Symbol identifier,
+                  const Type *type,
                   bool isMutable,
-                  std::unique_ptr<ResolvedExpr> initializer=nullptr)
-                  : ResolvedDecl(location,std::move(identifier),type),
-                  initializer(std::move(initializer)),
+                  ResolvedExpr *initializer=nullptr)
+                  : ResolvedDecl(Kind::VarDecl, location,identifier,type),
+                  initializer(initializer),
                   isMutable(isMutable){}
   
   void dump(size_t level=0)const override;
   std::string indent(size_t level) const { return std::string(level * 2, ' '); }
+
+  static bool classof(const ResolvedDecl *decl) {
+    return decl->getKind() == Kind::VarDecl;
+  }
 };
 
 struct ResolvedDeclStmt:public ResolvedStmt{
-  std::unique_ptr<ResolvedVarDecl> varDecl;
+  ResolvedVarDecl *varDecl;
   
   ResolvedDeclStmt(SourceLocation location,
-                    std::unique_ptr<ResolvedVarDecl> varDecl)
-                    : ResolvedStmt(location),
-                      varDecl(std::move(varDecl)){}
+                    ResolvedVarDecl *varDecl)
+                    : ResolvedStmt(Kind::DeclStmt, location),
+                      varDecl(varDecl){}
   
   void dump(size_t level=0)const override;
+
+  static bool classof(const ResolvedStmt *stmt) {
+    return stmt->getKind() == Kind::DeclStmt;
+  }
 };
 
 struct ResolvedAssignment:public ResolvedStmt{
-  std::unique_ptr<ResolvedDeclRefExpr> variable;
-  std::unique_ptr<ResolvedExpr> expr;
+  ResolvedDeclRefExpr *variable;
+  ResolvedExpr *expr;
 
   ResolvedAssignment(SourceLocation location,
-                     std::unique_ptr<ResolvedDeclRefExpr> variable,
-                     std::unique_ptr<ResolvedExpr> expr)
-      : ResolvedStmt(location),
-        variable(std::move(variable)),
-        expr(std::move(expr)) {}
+                     ResolvedDeclRefExpr *variable,
+                     ResolvedExpr *expr)
+      : ResolvedStmt(Kind::Assignment, location),
+        variable(variable),
+        expr(expr) {}
 
   void dump(size_t level = 0) const override;
+
+  static bool classof(const ResolvedStmt *stmt) {
+    return stmt->getKind() == Kind::Assignment;
+  }
 };
 
-}
\ No newline at end of file
+}
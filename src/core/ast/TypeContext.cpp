@@ -0,0 +1,27 @@
+#include "TypeContext.h"
+
+hlx::TypeContext &hlx::TypeContext::get() {
+  static TypeContext typeContext;
+  return typeContext;
+}
+
+const hlx::Type *hlx::TypeContext::get(const Type &type) {
+  switch (type.kind) {
+  case Type::Kind::Void:
+    return &voidType;
+  case Type::Kind::KwNumber:
+    return &kwNumberType;
+  case Type::Kind::Number:
+    return &numberType;
+  case Type::Kind::Integer:
+    return &integerType;
+  case Type::Kind::Custom:
+    break;
+  }
+
+  auto [it, inserted] =
+      customTypeByName.try_emplace(type.name.getId(), nullptr);
+  if (inserted)
+    it->second = &customTypes.emplace_back(type);
+  return it->second;
+}
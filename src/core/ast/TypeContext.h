@@ -0,0 +1,31 @@
+#pragma once
+#include "Ast.h"
+#include <deque>
+#include <unordered_map>
+
+namespace hlx {
+// Owns one object per distinct type, resolved nodes point to them, so two
+// resolved types are the same iff their pointers are.
+//
+// The builtin types exist from the start and looking them up only reads, so
+// Sema workers may do it concurrently. Other types are interned on first
+// use, which is not thread-safe, like the ConstantPool.
+class TypeContext {
+  const Type voidType = Type::builtinVoid();
+  const Type kwNumberType = Type::builtinKwNumber();
+  const Type numberType = Type::builtinNumber();
+  const Type integerType = Type::builtinInteger();
+  // By name, a deque keeps the addresses stable.
+  std::deque<Type> customTypes;
+  std::unordered_map<uint32_t, const Type *> customTypeByName;
+
+public:
+  static TypeContext &get();
+
+  const Type *getVoid() const { return &voidType; }
+  const Type *getNumber() const { return &numberType; }
+  const Type *getInteger() const { return &integerType; }
+  // The unique object equal to 'type'.
+  const Type *get(const Type &type);
+};
+} // namespace hlx
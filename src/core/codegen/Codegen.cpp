@@ -1,4 +1,5 @@
 #include "Codegen.h"
+#include <cmath>
 #include <llvm/IR/BasicBlock.h>
 #include <llvm/IR/Constants.h>
 #include <llvm/IR/DerivedTypes.h>
@@ -8,6 +9,7 @@
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Type.h>
 #include <llvm/IR/Value.h>
+#include <llvm/Support/Casting.h>
 #include <llvm/Support/ErrorHandling.h>
 #include <memory>
 #include <string_view>
@@ -22,6 +24,32 @@ llvm::Module *hlx::Codegen::generateIR() {
     generateFunctionBody(*function);
   }
 
+  return finishModule(resolvedTree);
+}
+
+llvm::Module *
+hlx::Codegen::finishModule(llvm::ArrayRef<ResolvedFunctionDecl *> module) {
+  // Bodies may have been generated in any order, the functions are laid out
+  // like the module lists them, followed by printf.
+  auto &functions = _module.getFunctionList();
+  for (auto &&functionDecl : module) {
+    llvm::Function *function = getFunction(*functionDecl);
+
+    // Nothing in the language unwinds. A pure function only touches its own
+    // stack, and one that also always returns can be called speculatively.
+    function->setDoesNotThrow();
+    if (functionDecl->isPure)
+      function->setDoesNotAccessMemory();
+    if (functionDecl->willReturn)
+      function->addFnAttr(llvm::Attribute::WillReturn);
+    if (functionDecl->isPure && functionDecl->willReturn)
+      function->addFnAttr(llvm::Attribute::Speculatable);
+
+    functions.splice(functions.end(), functions, function->getIterator());
+  }
+  if (auto *printf = _module.getFunction("printf"))
+    functions.splice(functions.end(), functions, printf->getIterator());
+
   generateMainWrapper();
 
   return &_module;
@@ -42,24 +70,36 @@ void hlx::Codegen::generateMainWrapper() {
   builder.CreateRet(llvm::ConstantInt::getSigned(builder.getInt32Ty(), 0));
 }
 
-void hlx::Codegen::generateFunctionDecl(
-    const ResolvedFunctionDecl &functionDecl) {
-  auto *retType = generateType(functionDecl.type);
+llvm::Function *
+hlx::Codegen::generateFunctionDecl(const ResolvedFunctionDecl &functionDecl) {
+  auto *retType = generateType(*functionDecl.type);
 
   std::vector<llvm::Type *> paramTypes;
   for (auto &&param : functionDecl.params) {
-    paramTypes.emplace_back(generateType(param->type));
+    paramTypes.emplace_back(generateType(*param->type));
   }
 
   auto *type = llvm::FunctionType::get(retType, paramTypes, false);
 
-  llvm::Function::Create(type, llvm::Function::ExternalLinkage,
-                         functionDecl.identifier, _module);
+  return llvm::Function::Create(type, llvm::Function::ExternalLinkage,
+                                functionDecl.identifier.str(), _module);
+}
+
+llvm::Function *
+hlx::Codegen::getFunction(const ResolvedFunctionDecl &functionDecl) {
+  if (auto *function = _module.getFunction(functionDecl.identifier.str()))
+    return function;
+  return generateFunctionDecl(functionDecl);
 }
 
 void hlx::Codegen::generateFunctionBody(
     const ResolvedFunctionDecl &functionDecl) {
-  auto *function = _module.getFunction(functionDecl.identifier);
+  auto *function = getFunction(functionDecl);
+  currentFunctionDecl = &functionDecl;
+  recurseBB = nullptr;
+  // Only locals are in here, those of the previous function may already be
+  // released, and their addresses reused.
+  declarations.clear();
 
   auto *entryBB = llvm::BasicBlock::Create(context, "entry", function);
   builder.SetInsertPoint(entryBB);
@@ -69,27 +109,30 @@ void hlx::Codegen::generateFunctionBody(
   allocaInsertPoint = new llvm::BitCastInst(undef, undef->getType(),
                                             "alloca.placeholder", entryBB);
 
-  bool isVoid = functionDecl.type.kind == Type::Kind::Void;
+  bool isVoid = functionDecl.type->kind == Type::Kind::Void;
   if (!isVoid)
-    retVal = allocateStackVariable(function, "retval");
+    retVal = allocateStackVariable(function, "retval", builder.getDoubleTy());
   retBB = llvm::BasicBlock::Create(context, "return");
 
   int idx = 0;
   for (auto &&arg : function->args()) {
-    const auto *paramDecl = functionDecl.params[idx].get();
-    arg.setName(paramDecl->identifier);
+    const auto *paramDecl = functionDecl.params[idx];
+    arg.setName(paramDecl->identifier.str());
 
-    llvm::Value *var = allocateStackVariable(function, paramDecl->identifier);
+    llvm::Value *var = allocateStackVariable(
+        function, paramDecl->identifier.str(), builder.getDoubleTy());
     builder.CreateStore(&arg, var);
 
     declarations[paramDecl] = var;
     ++idx;
   }
+  bodyBegin = new llvm::BitCastInst(undef, undef->getType(), "body.begin",
+                                    entryBB);
 
-  if (functionDecl.identifier == "println")
+  if (functionDecl.identifier == symbols::println)
     generateBuiltinPrintBody(functionDecl);
   else
-    generateBlock(*functionDecl.body);
+    generateBlock(*functionDecl.body, isVoid);
 
   if (retBB->hasNPredecessorsOrMore(1)) {
     builder.CreateBr(retBB);
@@ -99,6 +142,14 @@ void hlx::Codegen::generateFunctionBody(
 
   allocaInsertPoint->eraseFromParent();
   allocaInsertPoint = nullptr;
+  bodyBegin->eraseFromParent();
+  bodyBegin = nullptr;
+
+  // Every path ended in a tail call that returns by itself.
+  if (!builder.GetInsertBlock()) {
+    delete retBB;
+    return;
+  }
 
   if (isVoid) {
     builder.CreateRetVoid();
@@ -108,30 +159,55 @@ void hlx::Codegen::generateFunctionBody(
   builder.CreateRet(builder.CreateLoad(builder.getDoubleTy(), retVal));
 }
 
-llvm::Type *hlx::Codegen::generateType(hlx::Type type) {
+llvm::Type *hlx::Codegen::generateType(const hlx::Type &type) {
   if (type.kind == Type::Kind::Number)
     return builder.getDoubleTy();
+  if (type.kind == Type::Kind::Integer)
+    return builder.getInt64Ty();
   return builder.getVoidTy();
 }
 llvm::AllocaInst *
 hlx::Codegen::allocateStackVariable(llvm::Function *function,
-                                    const std::string_view identifier) {
+                                    const std::string_view identifier,
+                                    llvm::Type *type) {
   llvm::IRBuilder<> tmpBuilder(context);
   tmpBuilder.SetInsertPoint(allocaInsertPoint);
-  return tmpBuilder.CreateAlloca(tmpBuilder.getDoubleTy(), nullptr, identifier);
+  return tmpBuilder.CreateAlloca(type, nullptr, identifier);
 }
 
-void hlx::Codegen::generateBlock(const hlx::ResolvedBlock &block) {
-  for (auto &&stmt : block.statements) {
+void hlx::Codegen::generateBlock(const hlx::ResolvedBlock &block,
+                                 bool isTail) {
+  for (size_t i = 0; i < block.statements.size(); ++i) {
+    const ResolvedStmt *stmt = block.statements[i];
+    bool isLast = i + 1 == block.statements.size();
+    const auto *next =
+        isLast ? nullptr
+               : llvm::dyn_cast<ResolvedReturnStmt>(block.statements[i + 1]);
+    bool inTailPosition = (isTail && isLast) || (next && !next->expr);
+
+    if (inTailPosition) {
+      const auto *call = llvm::dyn_cast<ResolvedCallExpr>(stmt);
+      if (call && generateTailCall(*call)) {
+        builder.ClearInsertionPoint();
+        break;
+      }
+
+      if (const auto *ifStmt = llvm::dyn_cast<ResolvedIfStmt>(stmt)) {
+        generateIfStmt(*ifStmt, true);
+        continue;
+      }
+    }
+
     generateStmt(*stmt);
-    if (dynamic_cast<const ResolvedReturnStmt *>(stmt.get())) {
+    if (llvm::isa<ResolvedReturnStmt>(stmt)) {
       builder.ClearInsertionPoint();
       break;
     }
   }
 }
 
-llvm::Value *hlx::Codegen::generateIfStmt(const ResolvedIfStmt &stmt) {
+llvm::Value *hlx::Codegen::generateIfStmt(const ResolvedIfStmt &stmt,
+                                          bool isTail) {
   llvm::Function *function = getCurrentFunction();
 
   auto *trueBB = llvm::BasicBlock::Create(context, "if.true");
@@ -142,17 +218,17 @@ llvm::Value *hlx::Codegen::generateIfStmt(const ResolvedIfStmt &stmt) {
     elseBB = llvm::BasicBlock::Create(context, "if.false");
 
   llvm::Value *cond = generateExpr(*stmt.condition);
-  builder.CreateCondBr(doubleToBool(cond), trueBB, elseBB);
+  builder.CreateCondBr(toBool(cond), trueBB, elseBB);
 
   trueBB->insertInto(function);
   builder.SetInsertPoint(trueBB);
-  generateBlock(*stmt.trueBlock);
+  generateBlock(*stmt.trueBlock, isTail);
   builder.CreateBr(exitBB);
 
   if (stmt.falseBlock) {
     elseBB->insertInto(function);
     builder.SetInsertPoint(elseBB);
-    generateBlock(*stmt.falseBlock);
+    generateBlock(*stmt.falseBlock, isTail);
     builder.CreateBr(exitBB);
   }
 
@@ -172,7 +248,7 @@ llvm::Value *hlx::Codegen::generateWhileStmt(const ResolvedWhileStmt &stmt){
 
   builder.SetInsertPoint(header);
   llvm::Value *cond=generateExpr(*stmt.condition);
-  builder.CreateCondBr(doubleToBool(cond),body,exit);
+  builder.CreateCondBr(toBool(cond),body,exit);
 
   builder.SetInsertPoint(body);
   generateBlock(*stmt.body);
@@ -184,101 +260,259 @@ llvm::Value *hlx::Codegen::generateWhileStmt(const ResolvedWhileStmt &stmt){
 
 llvm::Value *hlx::Codegen::generateDeclStmt(const ResolvedDeclStmt &stmt){
    llvm::Function *function = getCurrentFunction();
-  const auto *decl = stmt.varDecl.get();
+  const auto *decl = stmt.varDecl;
 
-  llvm::AllocaInst *var = allocateStackVariable(function, decl->identifier);
+  llvm::AllocaInst *var = allocateStackVariable(
+      function, decl->identifier.str(), generateType(*decl->type));
 
   if (const auto &init = decl->initializer)
-    builder.CreateStore(generateExpr(*init), var);
+    builder.CreateStore(convert(generateExpr(*init), *decl->type), var);
 
   declarations[decl] = var;
   return nullptr;
 }
 
 llvm::Value *hlx::Codegen::generateAssignment(const ResolvedAssignment &stmt){
-  return builder.CreateStore(generateExpr(*stmt.expr), declarations[stmt.variable->decl]);
+  const ResolvedDecl *decl=stmt.variable->decl;
+  return builder.CreateStore(convert(generateExpr(*stmt.expr),*decl->type),declarations[decl]);
 }
 
 llvm::Value *hlx::Codegen::generateStmt(const hlx::ResolvedStmt &stmt) {
-  if (auto *expr = dynamic_cast<const ResolvedExpr *>(&stmt)) {
-    return generateExpr(*expr);
-  }
-
-  if (auto *returnStmt = dynamic_cast<const ResolvedReturnStmt *>(&stmt)) {
-    return generateReturnStmt(*returnStmt);
+  switch (stmt.getKind()) {
+  case ResolvedStmt::Kind::ReturnStmt:
+    return generateReturnStmt(llvm::cast<ResolvedReturnStmt>(stmt));
+  case ResolvedStmt::Kind::IfStmt:
+    return generateIfStmt(llvm::cast<ResolvedIfStmt>(stmt));
+  case ResolvedStmt::Kind::WhileStmt:
+    return generateWhileStmt(llvm::cast<ResolvedWhileStmt>(stmt));
+  case ResolvedStmt::Kind::DeclStmt:
+    return generateDeclStmt(llvm::cast<ResolvedDeclStmt>(stmt));
+  case ResolvedStmt::Kind::Assignment:
+    return generateAssignment(llvm::cast<ResolvedAssignment>(stmt));
+  default:
+    return generateExpr(llvm::cast<ResolvedExpr>(stmt));
   }
+}
 
-  if (auto *ifStmt = dynamic_cast<const ResolvedIfStmt *>(&stmt)) {
-    return generateIfStmt(*ifStmt);
-  }
+llvm::Value *hlx::Codegen::generateReturnStmt(const ResolvedReturnStmt &stmt) {
+  if (stmt.expr) {
+    const ResolvedExpr *expr = stmt.expr;
+    while (const auto *grouping = llvm::dyn_cast<ResolvedGroupingExpr>(expr))
+      expr = grouping->expr;
 
-  if(auto *whileStmt=dynamic_cast<const ResolvedWhileStmt *>(&stmt)){
-    return generateWhileStmt(*whileStmt);
-  }
+    const auto *call = llvm::dyn_cast<ResolvedCallExpr>(expr);
+    if (llvm::Instruction *terminator = call ? generateTailCall(*call) : nullptr)
+      return terminator;
 
-  if(auto *declStmt=dynamic_cast<const ResolvedDeclStmt *>(&stmt)){
-    return generateDeclStmt(*declStmt);
+    builder.CreateStore(toDouble(generateExpr(*stmt.expr)), retVal);
   }
 
-    if (auto *assignment = dynamic_cast<const ResolvedAssignment *>(&stmt)){
-      return generateAssignment(*assignment);
-}
-  llvm_unreachable("unknown statement");
-}
-
-llvm::Value *hlx::Codegen::generateReturnStmt(const ResolvedReturnStmt &stmt) {
-  if (stmt.expr)
-    builder.CreateStore(generateExpr(*stmt.expr), retVal);
-
   return builder.CreateBr(retBB);
 }
 
+// Walks the expression with an explicit stack, so the depth of the tree is
+// not limited by the call stack. A frame either computes the value of its
+// expression, or, if it has target blocks, branches on its truth value.
+// '&&' and '||' are lowered to short-circuiting control flow in both cases.
 llvm::Value *hlx::Codegen::generateExpr(const ResolvedExpr &expr) {
+  struct Frame {
+    const ResolvedExpr *expr;
+    llvm::BasicBlock *trueBB = nullptr;
+    llvm::BasicBlock *falseBB = nullptr;
+    // Number of children visited so far.
+    size_t step = 0;
+    // '&&' and '||': the block evaluating the RHS and the merge block.
+    llvm::BasicBlock *rhsBB = nullptr;
+    llvm::BasicBlock *mergeBB = nullptr;
+  };
+
+  std::vector<Frame> frames{{&expr}};
+  std::vector<llvm::Value *> values;
+
+  while (!frames.empty()) {
+    Frame &frame = frames.back();
+    const ResolvedExpr &current = *frame.expr;
+
+    const auto *binop = llvm::dyn_cast<ResolvedBinaryOperator>(&current);
+    bool isOr = binop && binop->op == TokenKind::PipePipe;
+    bool isLogical = isOr || (binop && binop->op == TokenKind::AmpAmp);
+
+    if (frame.trueBB) {
+      if (isLogical) {
+        if (frame.step++ == 0) {
+          frame.rhsBB = llvm::BasicBlock::Create(
+              context, isOr ? "or.lhs.false" : "and.lhs.true",
+              getCurrentFunction());
+          frames.push_back({binop->lhs, isOr ? frame.trueBB : frame.rhsBB,
+                            isOr ? frame.rhsBB : frame.falseBB});
+          continue;
+        }
+
+        builder.SetInsertPoint(frame.rhsBB);
+        frame = Frame{binop->rhs, frame.trueBB, frame.falseBB};
+        continue;
+      }
+
+      if (frame.step++ == 0) {
+        frames.push_back({&current});
+        continue;
+      }
+
+      builder.CreateCondBr(toBool(values.back()), frame.trueBB,
+                           frame.falseBB);
+      values.pop_back();
+      frames.pop_back();
+      continue;
+    }
 
-  if (auto *number = dynamic_cast<const ResolvedNumberLiteral *>(&expr)) {
-    return llvm::ConstantFP::get(builder.getDoubleTy(), number->value);
-  }
+    switch (current.getKind()) {
+    case ResolvedStmt::Kind::NumberLiteral:
+      values.emplace_back(
+          generateConstant(llvm::cast<ResolvedNumberLiteral>(current).constant));
+      break;
+    case ResolvedStmt::Kind::DeclRefExpr: {
+      const ResolvedDecl *decl = llvm::cast<ResolvedDeclRefExpr>(current).decl;
+      values.emplace_back(
+          builder.CreateLoad(generateType(*decl->type), declarations[decl]));
+      break;
+    }
+    case ResolvedStmt::Kind::GroupingExpr:
+      if (frame.step++ == 0) {
+        frames.push_back({llvm::cast<ResolvedGroupingExpr>(current).expr});
+        continue;
+      }
+      break;
+    case ResolvedStmt::Kind::UnaryOperator: {
+      const auto &unop = llvm::cast<ResolvedUnaryOperator>(current);
+      if (frame.step++ == 0) {
+        frames.push_back({unop.operand});
+        continue;
+      }
+
+      values.back() = generateUnaryOperator(unop, values.back());
+      break;
+    }
+    case ResolvedStmt::Kind::CallExpr: {
+      const auto &call = llvm::cast<ResolvedCallExpr>(current);
+      if (frame.step < call.arguments.size()) {
+        frames.push_back({call.arguments[frame.step++]});
+        continue;
+      }
+
+      std::vector<llvm::Value *> args(values.end() - call.arguments.size(),
+                                      values.end());
+      values.resize(values.size() - args.size());
+      values.emplace_back(generateCallExpr(call, args));
+      break;
+    }
+    case ResolvedStmt::Kind::BinaryOperator:
+      if (!isLogical) {
+        if (frame.step < 2) {
+          frames.push_back({frame.step++ == 0 ? binop->lhs : binop->rhs});
+          continue;
+        }
+
+        llvm::Value *rhs = values.back();
+        values.pop_back();
+        values.back() = generateBinaryOperator(*binop, values.back(), rhs);
+        break;
+      }
+
+      if (frame.step == 0) {
+        llvm::Function *function = getCurrentFunction();
+        frame.rhsBB = llvm::BasicBlock::Create(
+            context, isOr ? "or.rhs" : "and.rhs", function);
+        frame.mergeBB = llvm::BasicBlock::Create(
+            context, isOr ? "or.merge" : "and.merge", function);
+        frame.step = 1;
+        frames.push_back({binop->lhs, isOr ? frame.mergeBB : frame.rhsBB,
+                          isOr ? frame.rhsBB : frame.mergeBB});
+        continue;
+      }
+
+      if (frame.step == 1) {
+        builder.SetInsertPoint(frame.rhsBB);
+        frame.step = 2;
+        frames.push_back({binop->rhs});
+        continue;
+      }
+
+      values.back() = generateLogicalMerge(isOr, frame.mergeBB,
+                                           toBool(values.back()));
+      break;
+    default:
+      llvm_unreachable("unexpected expression");
+    }
 
-  if (auto *dre = dynamic_cast<const ResolvedDeclRefExpr *>(&expr)) {
-    return builder.CreateLoad(builder.getDoubleTy(), declarations[dre->decl]);
+    frames.pop_back();
   }
 
-  if (auto *call = dynamic_cast<const ResolvedCallExpr *>(&expr))
-    return generateCallExpr(*call);
-
-  if (auto *binop = dynamic_cast<const ResolvedBinaryOperator *>(&expr))
-    return generateBinaryOperator(*binop);
-
-  if (auto *unop = dynamic_cast<const ResolvedUnaryOperator *>(&expr))
-    return generateUnaryOperator(*unop);
+  return values.back();
+}
 
-  if (auto *grouping = dynamic_cast<const ResolvedGroupingExpr *>(&expr))
-    return generateExpr(*grouping->expr);
+llvm::Constant *hlx::Codegen::generateConstant(uint32_t idx) {
+  const ConstantPool &pool = ConstantPool::get();
+  if (constants.size() < pool.size())
+    constants.resize(pool.size());
 
-  llvm_unreachable("unexpected expression");
+  if (!constants[idx])
+    constants[idx] = llvm::ConstantFP::get(builder.getDoubleTy(),
+                                           pool.getValue(idx));
+  return constants[idx];
 }
 
 llvm::Value *
-hlx::Codegen::generateUnaryOperator(const ResolvedUnaryOperator &unop) {
-  llvm::Value *operand = generateExpr(*unop.operand);
-
-  if (unop.op == TokenKind::Minus)
-    return builder.CreateFNeg(operand);
+hlx::Codegen::generateUnaryOperator(const ResolvedUnaryOperator &unop,
+                                    llvm::Value *operand) {
+  if (unop.op == TokenKind::Minus) {
+    if (unop.type->kind == Type::Kind::Integer)
+      return builder.CreateNSWNeg(toInteger(operand));
+    return builder.CreateFNeg(toDouble(operand));
+  }
 
   if (unop.op == TokenKind::Excl)
-    return boolToDouble(builder.CreateNot(doubleToBool(operand)));
+    return boolToDouble(builder.CreateNot(toBool(operand)));
 
   llvm_unreachable("unknown unary op");
   return nullptr;
 }
 
+namespace {
+bool isComparison(hlx::TokenKind op) {
+  return op == hlx::TokenKind::Lt || op == hlx::TokenKind::Gt ||
+         op == hlx::TokenKind::EqualEqual || op == hlx::TokenKind::NotEqual ||
+         op == hlx::TokenKind::MoreThanEql || op == hlx::TokenKind::LessThanEql;
+}
+} // namespace
+
 llvm::Value *
-hlx::Codegen::generateBinaryOperator(const ResolvedBinaryOperator &binop) {
+hlx::Codegen::generateBinaryOperator(const ResolvedBinaryOperator &binop,
+                                     llvm::Value *lhs, llvm::Value *rhs) {
   TokenKind op = binop.op;
 
-  llvm::Value *lhs = generateExpr(*binop.lhs);
-  llvm::Value *rhs = generateExpr(*binop.rhs);
+  // Sema proved the operation exact and in range, see inferIntegers().
+  if (binop.type->kind == Type::Kind::Integer) {
+    lhs = toInteger(lhs);
+    rhs = toInteger(rhs);
+    if (op == TokenKind::Plus)
+      return builder.CreateNSWAdd(lhs, rhs);
+    if (op == TokenKind::Minus)
+      return builder.CreateNSWSub(lhs, rhs);
+    if (op == TokenKind::Asterisk)
+      return builder.CreateNSWMul(lhs, rhs);
+    if (op == TokenKind::Mod)
+      return builder.CreateSRem(lhs, rhs);
+    llvm_unreachable("unexpected integer operator");
+  }
+
+  bool hasInteger =
+      lhs->getType()->isIntegerTy() || rhs->getType()->isIntegerTy();
+  if (hasInteger && isComparison(op) && isExactInteger(lhs) &&
+      isExactInteger(rhs))
+    return generateIntegerComparison(op, toInteger(lhs), toInteger(rhs));
 
+  lhs = toDouble(lhs);
+  rhs = toDouble(rhs);
   if (op == TokenKind::Plus)
     return builder.CreateFAdd(lhs, rhs);
   if (op == TokenKind::Minus)
@@ -301,46 +535,94 @@ hlx::Codegen::generateBinaryOperator(const ResolvedBinaryOperator &binop) {
     return boolToDouble(builder.CreateFCmpOGE(lhs, rhs));
   if(op==TokenKind::LessThanEql)
     return boolToDouble(builder.CreateFCmpOLE(lhs, rhs));
-  if (op == TokenKind::AmpAmp || op == TokenKind::PipePipe) {
-    llvm::Function *function = getCurrentFunction();
-    bool isOr = op == TokenKind::PipePipe;
-    auto *rhsTag = isOr ? "or.rhs" : "and.rhs";
-    auto *mergeTag = isOr ? "or.merge" : "and.merge";
-
-    auto *rhsBB = llvm::BasicBlock::Create(context, rhsTag, function);
-    auto *mergeBB = llvm::BasicBlock::Create(context, mergeTag, function);
-    llvm::BasicBlock *trueBB = isOr ? mergeBB : rhsBB;
-    llvm::BasicBlock *falseBB = isOr ? rhsBB : mergeBB;
-    generateConditionalOperator(*binop.lhs, trueBB, falseBB);
-    builder.SetInsertPoint(rhsBB);
-    llvm::Value *rhs = doubleToBool(generateExpr(*binop.rhs));
-    builder.CreateBr(mergeBB);
-    rhsBB = builder.GetInsertBlock();
-    builder.SetInsertPoint(mergeBB);
-    llvm::PHINode *phi = builder.CreatePHI(builder.getInt1Ty(), 2);
-    for (auto it = pred_begin(mergeBB); it != pred_end(mergeBB); ++it) {
-      if (*it == rhsBB)
-        phi->addIncoming(rhs, rhsBB);
-      else
-        phi->addIncoming(builder.getInt1(isOr), *it);
-    }
-
-    return boolToDouble(phi);
-  }
 
   llvm_unreachable("unexpected binary operator");
   return nullptr;
 }
 
-llvm::Value *hlx::Codegen::generateCallExpr(const ResolvedCallExpr &call) {
-  llvm::Function *callee = _module.getFunction(call.callee->identifier);
+llvm::Value *hlx::Codegen::generateIntegerComparison(TokenKind op,
+                                                     llvm::Value *lhs,
+                                                     llvm::Value *rhs) {
+  if (op == TokenKind::Lt)
+    return boolToDouble(builder.CreateICmpSLT(lhs, rhs));
+  if (op == TokenKind::Gt)
+    return boolToDouble(builder.CreateICmpSGT(lhs, rhs));
+  if (op == TokenKind::EqualEqual)
+    return boolToDouble(builder.CreateICmpEQ(lhs, rhs));
+  if (op == TokenKind::NotEqual)
+    return boolToDouble(builder.CreateICmpNE(lhs, rhs));
+  if (op == TokenKind::MoreThanEql)
+    return boolToDouble(builder.CreateICmpSGE(lhs, rhs));
+  return boolToDouble(builder.CreateICmpSLE(lhs, rhs));
+}
+
+// Ends a value-producing '&&' or '||' whose RHS was just evaluated to 'rhs'
+// in the current block. Every other predecessor of 'mergeBB' got there by
+// short-circuiting.
+llvm::Value *hlx::Codegen::generateLogicalMerge(bool isOr,
+                                                llvm::BasicBlock *mergeBB,
+                                                llvm::Value *rhs) {
+  builder.CreateBr(mergeBB);
+  llvm::BasicBlock *rhsBB = builder.GetInsertBlock();
+  builder.SetInsertPoint(mergeBB);
+  llvm::PHINode *phi = builder.CreatePHI(builder.getInt1Ty(), 2);
+  for (auto it = pred_begin(mergeBB); it != pred_end(mergeBB); ++it) {
+    if (*it == rhsBB)
+      phi->addIncoming(rhs, rhsBB);
+    else
+      phi->addIncoming(builder.getInt1(isOr), *it);
+  }
+
+  return boolToDouble(phi);
+}
+
+llvm::Value *hlx::Codegen::generateCallExpr(const ResolvedCallExpr &call,
+                                            llvm::ArrayRef<llvm::Value *> args) {
+  llvm::Function *callee = getFunction(*call.callee);
+  std::vector<llvm::Value *> doubleArgs;
+  for (auto &&arg : args)
+    doubleArgs.emplace_back(toDouble(arg));
+  return builder.CreateCall(callee, doubleArgs);
+}
+
+// A call whose result is returned right away, so it can reuse the frame of
+// the caller if both have the same prototype: a call of the current
+// function jumps back to its start with the parameters reassigned, and
+// any other call becomes a musttail call. Either way the stack does not
+// grow, also without optimizations. Returns null, generating nothing, if
+// the prototypes differ.
+llvm::Instruction *
+hlx::Codegen::generateTailCall(const ResolvedCallExpr &call) {
+  llvm::Function *function = getCurrentFunction();
+  llvm::Function *callee = getFunction(*call.callee);
+  if (callee->getFunctionType() != function->getFunctionType())
+    return nullptr;
 
+  // All arguments are evaluated before any parameter is reassigned.
   std::vector<llvm::Value *> args;
-  for (auto &&arg : call.arguments) {
+  for (auto &&arg : call.arguments)
     args.emplace_back(generateExpr(*arg));
+
+  if (call.callee != currentFunctionDecl) {
+    auto *result = llvm::cast<llvm::CallInst>(generateCallExpr(call, args));
+    result->setTailCallKind(llvm::CallInst::TCK_MustTail);
+    if (callee->getReturnType()->isVoidTy())
+      return builder.CreateRetVoid();
+    return builder.CreateRet(result);
+  }
+
+  if (!recurseBB) {
+    llvm::BasicBlock *entryBB = bodyBegin->getParent();
+    bool inEntry = builder.GetInsertBlock() == entryBB;
+    recurseBB = entryBB->splitBasicBlock(bodyBegin, "tailrecurse");
+    if (inEntry)
+      builder.SetInsertPoint(recurseBB);
   }
 
-  return builder.CreateCall(callee, args);
+  for (size_t i = 0; i < args.size(); ++i)
+    builder.CreateStore(toDouble(args[i]),
+                        declarations[currentFunctionDecl->params[i]]);
+  return builder.CreateBr(recurseBB);
 }
 
 void hlx::Codegen::generateBuiltinPrintBody(
@@ -354,46 +636,48 @@ void hlx::Codegen::generateBuiltinPrintBody(
   auto *format = builder.CreateGlobalStringPtr("%.15g\n");
 
   llvm::Value *param = builder.CreateLoad(
-      builder.getDoubleTy(), declarations[println.params[0].get()]);
+      builder.getDoubleTy(), declarations[println.params[0]]);
 
   builder.CreateCall(printf, {format, param});
 }
 
-llvm::Value *hlx::Codegen::doubleToBool(llvm::Value *v) {
+llvm::Value *hlx::Codegen::toBool(llvm::Value *v) {
+  if (v->getType()->isIntegerTy())
+    return builder.CreateICmpNE(v, builder.getInt64(0), "to.bool");
   return builder.CreateFCmpONE(
       v, llvm::ConstantFP::get(builder.getDoubleTy(), 0.0), "to.bool");
 }
 
-llvm::Value *hlx::Codegen::boolToDouble(llvm::Value *v) {
-  return builder.CreateUIToFP(v, builder.getDoubleTy(), "to.double");
+llvm::Value *hlx::Codegen::toDouble(llvm::Value *v) {
+  if (v->getType()->isIntegerTy())
+    return builder.CreateSIToFP(v, builder.getDoubleTy(), "to.double");
+  return v;
 }
 
-void hlx::Codegen::generateConditionalOperator(const ResolvedExpr &op,
-                                               llvm::BasicBlock *trueBB,
-                                               llvm::BasicBlock *falseBB) {
-  llvm::Function *function = getCurrentFunction();
-  const auto *binop = dynamic_cast<const ResolvedBinaryOperator *>(&op);
-
-  if (binop && binop->op == TokenKind::PipePipe) {
-    llvm::BasicBlock *nextBB =
-        llvm::BasicBlock::Create(context, "or.lhs.false", function);
-    generateConditionalOperator(*binop->lhs, trueBB, nextBB);
-    builder.SetInsertPoint(nextBB);
-    generateConditionalOperator(*binop->rhs, trueBB, falseBB);
-    return;
-  }
+llvm::Value *hlx::Codegen::toInteger(llvm::Value *v) {
+  if (v->getType()->isDoubleTy())
+    return builder.CreateFPToSI(v, builder.getInt64Ty(), "to.integer");
+  return v;
+}
 
-  if (binop && binop->op == TokenKind::AmpAmp) {
-    llvm::BasicBlock *nextBB =
-        llvm::BasicBlock::Create(context, "and.lhs.true", function);
-    generateConditionalOperator(*binop->lhs, nextBB, falseBB);
-    builder.SetInsertPoint(nextBB);
-    generateConditionalOperator(*binop->rhs, trueBB, falseBB);
-    return;
-  }
+llvm::Value *hlx::Codegen::convert(llvm::Value *v, const Type &type) {
+  return type.kind == Type::Kind::Integer ? toInteger(v) : toDouble(v);
+}
 
-  llvm::Value *val = doubleToBool(generateExpr(op));
-  builder.CreateCondBr(val, trueBB, falseBB);
+// Also a double constant that is an integer in the range of Integer, it is
+// converted for free.
+bool hlx::Codegen::isExactInteger(llvm::Value *v) {
+  if (v->getType()->isIntegerTy())
+    return true;
+  const auto *constant = llvm::dyn_cast<llvm::ConstantFP>(v);
+  if (!constant)
+    return false;
+  double value = constant->getValueAPF().convertToDouble();
+  return std::fabs(value) <= 9007199254740992.0 && std::trunc(value) == value;
+}
+
+llvm::Value *hlx::Codegen::boolToDouble(llvm::Value *v) {
+  return builder.CreateUIToFP(v, builder.getDoubleTy(), "to.double");
 }
 
 llvm::Function *hlx::Codegen::getCurrentFunction() {
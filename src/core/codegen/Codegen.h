@@ -24,11 +24,13 @@ namespace hlx {
       llvm::IRBuilder<> builder;
       llvm::Module _module;
 
-      std::vector<std::unique_ptr<hlx::ResolvedFunctionDecl>> resolvedTree;
+      std::vector<hlx::ResolvedFunctionDecl *> resolvedTree;
       std::map<const ResolvedDecl *, llvm::Value *> declarations;
+      // ConstantPool index -> materialized constant.
+      std::vector<llvm::Constant *> constants;
 
       public:
-      Codegen(std::vector<std::unique_ptr<ResolvedFunctionDecl>> resolvedTree,std::string_view sourcePath)
+      Codegen(std::vector<ResolvedFunctionDecl *> resolvedTree,std::string_view sourcePath)
       : resolvedTree(std::move(resolvedTree)),
       builder(context),
       _module("<translation_unit>", context){
@@ -37,31 +39,52 @@ namespace hlx {
       }
 
       llvm::Module *generateIR();
-      llvm::Type *generateType(Type type);
+      // Sets the attributes of the functions in 'module', which must all have
+      // a body by now, orders them like 'module' and adds the entry point.
+      // For callers that generate the bodies themselves, one at a time.
+      llvm::Module *finishModule(llvm::ArrayRef<ResolvedFunctionDecl *> module);
+      llvm::Type *generateType(const Type &type);
       llvm::Instruction *allocaInsertPoint;
       llvm::Value *retVal=nullptr;
       llvm::BasicBlock *retBB=nullptr;
-      void generateFunctionDecl(const ResolvedFunctionDecl &functionDecl);
+      const ResolvedFunctionDecl *currentFunctionDecl=nullptr;
+      // Self tail calls jump to 'recurseBB', split off the entry block at
+      // 'bodyBegin' once the first one is generated.
+      llvm::Instruction *bodyBegin=nullptr;
+      llvm::BasicBlock *recurseBB=nullptr;
+      llvm::Function *generateFunctionDecl(const ResolvedFunctionDecl &functionDecl);
+      // Declared when first needed.
+      llvm::Function *getFunction(const ResolvedFunctionDecl &functionDecl);
       void generateFunctionBody(const ResolvedFunctionDecl &functionDecl);
-      llvm::AllocaInst *allocateStackVariable(llvm::Function *function,const std::string_view identifier);
-      void generateBlock(const ResolvedBlock &block);
+      llvm::AllocaInst *allocateStackVariable(llvm::Function *function,const std::string_view identifier,llvm::Type *type);
+      // Statements of a block in tail position are followed by nothing but
+      // returning from a void function.
+      void generateBlock(const ResolvedBlock &block,bool isTail=false);
       llvm::Value *generateStmt(const ResolvedStmt &stmt);
       llvm::Value *generateReturnStmt(const ResolvedReturnStmt &stmt);
       llvm::Value *generateExpr(const ResolvedExpr &expr);
-      llvm::Value *generateIfStmt(const ResolvedIfStmt &stmt);
+      llvm::Constant *generateConstant(uint32_t idx);
+      llvm::Value *generateIfStmt(const ResolvedIfStmt &stmt,bool isTail=false);
       llvm::Value *generateWhileStmt(const ResolvedWhileStmt &stmt);
       llvm::Value *generateDeclStmt(const ResolvedDeclStmt &stmt);
       llvm::Value *generateAssignment(const ResolvedAssignment &stmt);
-      llvm::Value *generateCallExpr(const ResolvedCallExpr &call);
-      llvm::Value *generateUnaryOperator(const ResolvedUnaryOperator &unop);
-      llvm::Value *generateBinaryOperator(const ResolvedBinaryOperator &binop);
-      void generateConditionalOperator(const ResolvedExpr &op,
-                                      llvm::BasicBlock *trueBB,
-                                      llvm::BasicBlock *falseBB);
+      llvm::Value *generateCallExpr(const ResolvedCallExpr &call,llvm::ArrayRef<llvm::Value *> args);
+      llvm::Instruction *generateTailCall(const ResolvedCallExpr &call);
+      llvm::Value *generateUnaryOperator(const ResolvedUnaryOperator &unop,llvm::Value *operand);
+      // Operands are double or i64 values, Integer operators take i64.
+      llvm::Value *generateBinaryOperator(const ResolvedBinaryOperator &binop,llvm::Value *lhs,llvm::Value *rhs);
+      llvm::Value *generateIntegerComparison(TokenKind op,llvm::Value *lhs,llvm::Value *rhs);
+      llvm::Value *generateLogicalMerge(bool isOr,llvm::BasicBlock *mergeBB,llvm::Value *rhs);
       llvm::Function *getCurrentFunction();
 
-      llvm::Value *doubleToBool(llvm::Value *v);
+      // Values of Integer expressions are i64, all others double.
+      llvm::Value *toBool(llvm::Value *v);
       llvm::Value *boolToDouble(llvm::Value *v);
+      llvm::Value *toDouble(llvm::Value *v);
+      llvm::Value *toInteger(llvm::Value *v);
+      // The value as stored in a variable of type 'type'.
+      llvm::Value *convert(llvm::Value *v,const Type &type);
+      bool isExactInteger(llvm::Value *v);
 
       void generateBuiltinPrintBody(const ResolvedFunctionDecl &println);
       void generateMainWrapper();
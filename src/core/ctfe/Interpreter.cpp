@@ -0,0 +1,546 @@
+#include "Interpreter.h"
+#include "../../utils/ConstantPool.h"
+#include "../sema/Effects.h"
+#include "../sema/IntegerInference.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/Support/Casting.h>
+#include <llvm/Support/ErrorHandling.h>
+
+namespace hlx {
+namespace {
+// Truth value of a number the way Codegen::doubleToBool() computes it, an
+// ordered comparison with zero, so NaN is false.
+bool toBool(double value) { return value < 0 || value > 0; }
+
+uint64_t toBits(double value) {
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+class DepthScope {
+  unsigned &depth;
+
+public:
+  explicit DepthScope(unsigned &depth) : depth(depth) { ++depth; }
+  ~DepthScope() { --depth; }
+};
+} // namespace
+
+size_t Interpreter::CallKeyHash::operator()(const CallKey &key) const {
+  size_t hash = std::hash<const void *>()(key.callee);
+  for (auto &&arg : key.args)
+    hash = hash * 31 + std::hash<uint64_t>()(arg);
+  return hash;
+}
+
+bool Interpreter::spendStep() {
+  ++totalSteps;
+  return ++steps <= stepBudget && totalSteps <= totalStepBudget;
+}
+
+Interpreter::Local *Interpreter::findLocal(const ResolvedDecl &decl) {
+  for (size_t i = locals.size(); i > frameBegin; --i)
+    if (locals[i - 1].decl == &decl)
+      return &locals[i - 1];
+  return nullptr;
+}
+
+Interpreter::Flow Interpreter::execute(const ResolvedBlock &block) {
+  size_t scopeBegin = locals.size();
+  Flow flow = Flow::Next;
+  for (auto &&stmt : block.statements) {
+    flow = execute(*stmt);
+    if (flow != Flow::Next)
+      break;
+  }
+
+  locals.resize(scopeBegin);
+  return flow;
+}
+
+Interpreter::Flow Interpreter::execute(const ResolvedStmt &stmt) {
+  if (!spendStep())
+    return Flow::Abort;
+
+  switch (stmt.getKind()) {
+  case ResolvedStmt::Kind::ReturnStmt: {
+    const auto &returnStmt = llvm::cast<ResolvedReturnStmt>(stmt);
+    if (returnStmt.expr) {
+      std::optional<double> value = evaluate(*returnStmt.expr);
+      if (!value)
+        return Flow::Abort;
+      returnValue = *value;
+    }
+    return Flow::Return;
+  }
+  case ResolvedStmt::Kind::IfStmt: {
+    const auto &ifStmt = llvm::cast<ResolvedIfStmt>(stmt);
+    std::optional<double> condition = evaluate(*ifStmt.condition);
+    if (!condition)
+      return Flow::Abort;
+    if (toBool(*condition))
+      return execute(*ifStmt.trueBlock);
+    return ifStmt.falseBlock ? execute(*ifStmt.falseBlock) : Flow::Next;
+  }
+  case ResolvedStmt::Kind::WhileStmt: {
+    const auto &whileStmt = llvm::cast<ResolvedWhileStmt>(stmt);
+    while (true) {
+      std::optional<double> condition = evaluate(*whileStmt.condition);
+      if (!condition)
+        return Flow::Abort;
+      if (!toBool(*condition))
+        return Flow::Next;
+
+      Flow flow = execute(*whileStmt.body);
+      if (flow != Flow::Next)
+        return flow;
+    }
+  }
+  case ResolvedStmt::Kind::DeclStmt: {
+    const ResolvedVarDecl &varDecl =
+        *llvm::cast<ResolvedDeclStmt>(stmt).varDecl;
+    std::optional<double> value;
+    if (varDecl.initializer) {
+      value = evaluate(*varDecl.initializer);
+      if (!value)
+        return Flow::Abort;
+    }
+    // Without an initializer the variable is undefined until assigned.
+    locals.push_back({&varDecl, value.value_or(0.0), value.has_value()});
+    return Flow::Next;
+  }
+  case ResolvedStmt::Kind::Assignment: {
+    const auto &assignment = llvm::cast<ResolvedAssignment>(stmt);
+    std::optional<double> value = evaluate(*assignment.expr);
+    Local *local = findLocal(*assignment.variable->decl);
+    if (!value || !local)
+      return Flow::Abort;
+    local->value = *value;
+    local->initialized = true;
+    return Flow::Next;
+  }
+  default:
+    return evaluate(llvm::cast<ResolvedExpr>(stmt)) ? Flow::Next
+                                                    : Flow::Abort;
+  }
+}
+
+std::optional<double> Interpreter::evaluate(const ResolvedExpr &expr) {
+  if (!spendStep() || depth >= depthBudget)
+    return std::nullopt;
+  DepthScope scope(depth);
+
+  switch (expr.getKind()) {
+  case ResolvedStmt::Kind::NumberLiteral:
+    return llvm::cast<ResolvedNumberLiteral>(expr).value;
+  case ResolvedStmt::Kind::DeclRefExpr: {
+    Local *local = findLocal(*llvm::cast<ResolvedDeclRefExpr>(expr).decl);
+    if (!local || !local->initialized)
+      return std::nullopt;
+    return local->value;
+  }
+  case ResolvedStmt::Kind::CallExpr:
+    return evaluateCall(llvm::cast<ResolvedCallExpr>(expr));
+  case ResolvedStmt::Kind::GroupingExpr:
+    return evaluate(*llvm::cast<ResolvedGroupingExpr>(expr).expr);
+  case ResolvedStmt::Kind::UnaryOperator: {
+    const auto &unary = llvm::cast<ResolvedUnaryOperator>(expr);
+    std::optional<double> operand = evaluate(*unary.operand);
+    if (!operand)
+      return std::nullopt;
+    if (unary.op == TokenKind::Minus)
+      return -*operand;
+    return !toBool(*operand);
+  }
+  case ResolvedStmt::Kind::BinaryOperator: {
+    const auto &binop = llvm::cast<ResolvedBinaryOperator>(expr);
+    std::optional<double> lhs = evaluate(*binop.lhs);
+    if (!lhs)
+      return std::nullopt;
+
+    // The RHS of a short-circuiting operator is not evaluated at all.
+    if (binop.op == TokenKind::AmpAmp && !toBool(*lhs))
+      return 0.0;
+    if (binop.op == TokenKind::PipePipe && toBool(*lhs))
+      return 1.0;
+
+    std::optional<double> rhs = evaluate(*binop.rhs);
+    if (!rhs)
+      return std::nullopt;
+
+    double l = *lhs;
+    double r = *rhs;
+    switch (binop.op) {
+    case TokenKind::Plus:
+      return l + r;
+    case TokenKind::Minus:
+      return l - r;
+    case TokenKind::Asterisk:
+      return l * r;
+    case TokenKind::Slash:
+      return l / r;
+    case TokenKind::Mod:
+      return std::fmod(l, r);
+    case TokenKind::Lt:
+      return l < r;
+    case TokenKind::Gt:
+      return l > r;
+    case TokenKind::LessThanEql:
+      return l <= r;
+    case TokenKind::MoreThanEql:
+      return l >= r;
+    case TokenKind::EqualEqual:
+      return l == r;
+    case TokenKind::NotEqual:
+      return l < r || l > r;
+    case TokenKind::AmpAmp:
+    case TokenKind::PipePipe:
+      return toBool(r);
+    default:
+      llvm_unreachable("unexpected binary operator");
+    }
+  }
+  default:
+    llvm_unreachable("unexpected expression");
+  }
+}
+
+std::optional<double>
+Interpreter::evaluateCall(const ResolvedCallExpr &call) {
+  std::vector<double> args;
+  for (auto &&arg : call.arguments) {
+    std::optional<double> value = evaluate(*arg);
+    if (!value)
+      return std::nullopt;
+    args.emplace_back(*value);
+  }
+
+  const ResolvedFunctionDecl &callee = *call.callee;
+  if (callee.identifier == symbols::println) {
+    if (!output || output->size() >= outputBudget)
+      return std::nullopt;
+    output->emplace_back(args[0]);
+    return 0.0;
+  }
+
+  CallKey key{&callee, {}};
+  std::transform(args.begin(), args.end(), std::back_inserter(key.args),
+                 toBits);
+  if (auto it = memo.find(key); it != memo.end())
+    return it->second;
+  if (exhausted.count(key))
+    return std::nullopt;
+
+  size_t startSteps = steps;
+  size_t printedBefore = output ? output->size() : 0;
+  size_t callerFrame = frameBegin;
+  frameBegin = locals.size();
+  for (size_t i = 0; i < args.size(); ++i)
+    locals.push_back({callee.params[i], args[i], true});
+
+  Flow flow = execute(*callee.body);
+  locals.resize(frameBegin);
+  frameBegin = callerFrame;
+
+  if (flow == Flow::Abort) {
+    if (steps > stepBudget && startSteps < stepBudget / 2)
+      exhausted.insert(std::move(key));
+    return std::nullopt;
+  }
+
+  double value = 0.0;
+  if (callee.type->kind != Type::Kind::Void) {
+    // Falling off the end leaves the return value undefined.
+    if (flow != Flow::Return)
+      return std::nullopt;
+    value = returnValue;
+  }
+
+  if (!output || output->size() == printedBefore)
+    memo.try_emplace(std::move(key), value);
+  return value;
+}
+
+std::optional<double>
+Interpreter::evaluateConstant(const ResolvedExpr &expr,
+                              std::vector<double> *printed) {
+  steps = 0;
+  output = printed;
+  std::optional<double> value = evaluate(expr);
+  output = nullptr;
+  locals.clear();
+  frameBegin = 0;
+
+  if (!value && printed)
+    printed->clear();
+  return value;
+}
+
+namespace {
+class ConstantCallRewriter {
+  Interpreter interpreter;
+  Arena &arena;
+  const ResolvedFunctionDecl &println;
+  // Calls left in the rewritten body and whether it has a loop.
+  std::vector<const ResolvedFunctionDecl *> callees;
+  bool hasLoop = false;
+
+  ResolvedNumberLiteral *makeLiteral(SourceLocation location, double value) {
+    return arena.make<ResolvedNumberLiteral>(
+        location, ConstantPool::get().intern(value), value);
+  }
+
+  ResolvedCallExpr *makePrintln(SourceLocation location, double value) {
+    std::vector<ResolvedExpr *> args{makeLiteral(location, value)};
+    return arena.make<ResolvedCallExpr>(location, println,
+                                        arena.copyArray(args));
+  }
+
+  // Nothing to gain from evaluating println of literals.
+  bool isTrivial(const ResolvedCallExpr &call) const {
+    return call.callee == &println &&
+           std::all_of(call.arguments.begin(), call.arguments.end(),
+                       [](const ResolvedExpr *arg) {
+                         return llvm::isa<ResolvedNumberLiteral>(arg);
+                       });
+  }
+
+  struct Frame {
+    ResolvedExpr *expr;
+    // Number of children rewritten so far.
+    size_t rewrittenChildren = 0;
+  };
+  // Stacks of rewrite(ResolvedExpr *), kept to reuse their memory.
+  std::vector<Frame> frames;
+  std::vector<ResolvedExpr *> results;
+
+  ResolvedExpr *rewrite(ResolvedExpr *expr);
+  ResolvedStmt *rewrite(ResolvedStmt *stmt);
+  void rewriteArguments(ResolvedCallExpr &call);
+
+public:
+  ConstantCallRewriter(Arena &arena, const ResolvedFunctionDecl &println)
+      : arena(arena), println(println) {}
+
+  void rewrite(ResolvedBlock &block);
+  // Rewrites the body of 'fn', its remaining callees are appended to
+  // 'calls'. Returns whether the body has a loop.
+  bool rewrite(ResolvedFunctionDecl &fn,
+               std::vector<const ResolvedFunctionDecl *> &calls);
+};
+
+bool ConstantCallRewriter::rewrite(
+    ResolvedFunctionDecl &fn,
+    std::vector<const ResolvedFunctionDecl *> &calls) {
+  callees.clear();
+  hasLoop = false;
+  rewrite(*fn.body);
+  calls = std::move(callees);
+  return hasLoop;
+}
+
+void ConstantCallRewriter::rewrite(ResolvedBlock &block) {
+  std::vector<ResolvedStmt *> statements;
+  bool changed = false;
+  for (auto &&stmt : block.statements) {
+    auto *call = llvm::dyn_cast<ResolvedCallExpr>(stmt);
+    std::vector<double> printed;
+    if (call && !isTrivial(*call) &&
+        interpreter.evaluateConstant(*call, &printed)) {
+      for (auto &&value : printed)
+        statements.emplace_back(makePrintln(call->location, value));
+      if (!printed.empty())
+        callees.emplace_back(&println);
+      changed = true;
+      continue;
+    }
+    // Evaluating the call failed, there is no point in trying it again.
+    if (call) {
+      rewriteArguments(*call);
+      callees.emplace_back(call->callee);
+      statements.emplace_back(call);
+      continue;
+    }
+
+    ResolvedStmt *rewritten = rewrite(stmt);
+    changed |= rewritten != stmt;
+    statements.emplace_back(rewritten);
+  }
+
+  if (changed)
+    block.statements = arena.copyArray(statements);
+}
+
+void ConstantCallRewriter::rewriteArguments(ResolvedCallExpr &call) {
+  std::vector<ResolvedExpr *> args;
+  for (auto &&arg : call.arguments)
+    args.emplace_back(rewrite(arg));
+
+  if (!std::equal(args.begin(), args.end(), call.arguments.begin()))
+    call.arguments = arena.copyArray(args);
+}
+
+ResolvedStmt *ConstantCallRewriter::rewrite(ResolvedStmt *stmt) {
+  switch (stmt->getKind()) {
+  case ResolvedStmt::Kind::ReturnStmt: {
+    auto *returnStmt = llvm::cast<ResolvedReturnStmt>(stmt);
+    if (returnStmt->expr)
+      returnStmt->expr = rewrite(returnStmt->expr);
+    return stmt;
+  }
+  case ResolvedStmt::Kind::IfStmt: {
+    auto *ifStmt = llvm::cast<ResolvedIfStmt>(stmt);
+    ifStmt->condition = rewrite(ifStmt->condition);
+    rewrite(*ifStmt->trueBlock);
+    if (ifStmt->falseBlock)
+      rewrite(*ifStmt->falseBlock);
+    return stmt;
+  }
+  case ResolvedStmt::Kind::WhileStmt: {
+    auto *whileStmt = llvm::cast<ResolvedWhileStmt>(stmt);
+    whileStmt->condition = rewrite(whileStmt->condition);
+    rewrite(*whileStmt->body);
+    hasLoop = true;
+    return stmt;
+  }
+  case ResolvedStmt::Kind::DeclStmt: {
+    ResolvedVarDecl *varDecl = llvm::cast<ResolvedDeclStmt>(stmt)->varDecl;
+    if (varDecl->initializer)
+      varDecl->initializer = rewrite(varDecl->initializer);
+    return stmt;
+  }
+  case ResolvedStmt::Kind::Assignment: {
+    auto *assignment = llvm::cast<ResolvedAssignment>(stmt);
+    assignment->expr = rewrite(assignment->expr);
+    return stmt;
+  }
+  default:
+    return rewrite(llvm::cast<ResolvedExpr>(stmt));
+  }
+}
+
+// Walks the expression with an explicit stack like Sema::resolveExpr().
+// A call is evaluated as a whole before its arguments are looked at, so
+// only the outermost call that can be evaluated is replaced.
+ResolvedExpr *ConstantCallRewriter::rewrite(ResolvedExpr *expr) {
+  if (llvm::isa<ResolvedNumberLiteral>(expr) ||
+      llvm::isa<ResolvedDeclRefExpr>(expr))
+    return expr;
+
+  frames.assign(1, {expr});
+  results.clear();
+
+  auto visit = [&](ResolvedExpr *child) {
+    ++frames.back().rewrittenChildren;
+    frames.push_back({child});
+  };
+
+  while (!frames.empty()) {
+    Frame &frame = frames.back();
+    ResolvedExpr *current = frame.expr;
+    ResolvedExpr *rewritten = current;
+
+    switch (current->getKind()) {
+    case ResolvedStmt::Kind::NumberLiteral:
+    case ResolvedStmt::Kind::DeclRefExpr:
+      break;
+    case ResolvedStmt::Kind::CallExpr: {
+      auto *call = llvm::cast<ResolvedCallExpr>(current);
+      if (frame.rewrittenChildren == 0 &&
+          call->type->kind != Type::Kind::Void) {
+        if (std::optional<double> value =
+                interpreter.evaluateConstant(*call, nullptr)) {
+          rewritten = makeLiteral(call->location, *value);
+          break;
+        }
+      }
+
+      if (frame.rewrittenChildren < call->arguments.size()) {
+        visit(call->arguments[frame.rewrittenChildren]);
+        continue;
+      }
+
+      std::vector<ResolvedExpr *> args(results.end() - call->arguments.size(),
+                                       results.end());
+      results.resize(results.size() - args.size());
+      if (!std::equal(args.begin(), args.end(), call->arguments.begin()))
+        call->arguments = arena.copyArray(args);
+      callees.emplace_back(call->callee);
+      break;
+    }
+    case ResolvedStmt::Kind::GroupingExpr: {
+      auto *grouping = llvm::cast<ResolvedGroupingExpr>(current);
+      if (frame.rewrittenChildren == 0) {
+        visit(grouping->expr);
+        continue;
+      }
+
+      grouping->expr = results.back();
+      results.pop_back();
+      break;
+    }
+    case ResolvedStmt::Kind::UnaryOperator: {
+      auto *unary = llvm::cast<ResolvedUnaryOperator>(current);
+      if (frame.rewrittenChildren == 0) {
+        visit(unary->operand);
+        continue;
+      }
+
+      unary->operand = results.back();
+      results.pop_back();
+      break;
+    }
+    case ResolvedStmt::Kind::BinaryOperator: {
+      auto *binop = llvm::cast<ResolvedBinaryOperator>(current);
+      if (frame.rewrittenChildren < 2) {
+        visit(frame.rewrittenChildren == 0 ? binop->lhs : binop->rhs);
+        continue;
+      }
+
+      binop->rhs = results.back();
+      results.pop_back();
+      binop->lhs = results.back();
+      results.pop_back();
+      break;
+    }
+    default:
+      llvm_unreachable("unexpected expression");
+    }
+
+    results.emplace_back(rewritten);
+    frames.pop_back();
+  }
+
+  return results.back();
+}
+} // namespace
+
+void evaluateConstantCalls(llvm::ArrayRef<ResolvedFunctionDecl *> module,
+                           Arena &arena) {
+  auto println = llvm::find_if(module, [](const ResolvedFunctionDecl *fn) {
+    return fn->identifier == symbols::println;
+  });
+  ConstantCallRewriter rewriter(arena, **println);
+
+  std::vector<std::vector<const ResolvedFunctionDecl *>> callees(
+      module.size());
+  std::vector<char> loops(module.size());
+  for (size_t i = 0; i < module.size(); ++i) {
+    if (module[i] != *println) {
+      loops[i] = rewriter.rewrite(*module[i], callees[i]);
+      // Literals in place of calls may make more values integers.
+      inferIntegers(*module[i]);
+    }
+  }
+
+  // Evaluated calls are gone, which can only leave functions with fewer
+  // effects than Sema inferred.
+  inferEffects(module, callees, loops);
+}
+} // namespace hlx
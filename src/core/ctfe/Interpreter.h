@@ -0,0 +1,92 @@
+#pragma once
+
+#include "../../utils/Arena.h"
+#include "../ast/ResolvedAst.h"
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace hlx {
+// Evaluates resolved expressions at compile time, with the semantics of the
+// code Codegen emits for them. Evaluation gives up when it would need a
+// value only known at runtime, e.g. a variable of the caller, or when it
+// runs out of budget, in which case the expression is simply left to run.
+//
+// Calls that return without printing are memoized for the lifetime of the
+// interpreter, so recursive definitions like fib only evaluate each
+// argument once.
+class Interpreter {
+public:
+  // Statements and expressions one evaluation may execute.
+  static constexpr size_t stepBudget = 1 << 20;
+  // Steps of all evaluations together, bounds the time spent on programs
+  // full of calls that never fit the budget.
+  static constexpr size_t totalStepBudget = 1 << 23;
+  // Nesting of expressions and calls, the interpreter is recursive.
+  static constexpr unsigned depthBudget = 1024;
+  // Values one evaluation may print.
+  static constexpr size_t outputBudget = 256;
+
+private:
+  struct Local {
+    const ResolvedDecl *decl;
+    double value;
+    bool initialized;
+  };
+  // Variables of all active calls, the current one starts at 'frameBegin'.
+  std::vector<Local> locals;
+  size_t frameBegin = 0;
+
+  size_t steps = 0;
+  size_t totalSteps = 0;
+  unsigned depth = 0;
+  // Receives what println prints, printing fails the evaluation if null.
+  std::vector<double> *output = nullptr;
+  double returnValue = 0.0;
+
+  struct CallKey {
+    const ResolvedFunctionDecl *callee;
+    // Bit patterns, so -0 and 0 are different arguments.
+    std::vector<uint64_t> args;
+
+    bool operator==(const CallKey &other) const {
+      return callee == other.callee && args == other.args;
+    }
+  };
+  struct CallKeyHash {
+    size_t operator()(const CallKey &key) const;
+  };
+  std::unordered_map<CallKey, double, CallKeyHash> memo;
+  // Calls that ran out of steps although they started with most of the
+  // budget, they are not tried again.
+  std::unordered_set<CallKey, CallKeyHash> exhausted;
+
+  enum class Flow { Next, Return, Abort };
+
+  bool spendStep();
+  Local *findLocal(const ResolvedDecl &decl);
+  Flow execute(const ResolvedBlock &block);
+  Flow execute(const ResolvedStmt &stmt);
+  std::optional<double> evaluate(const ResolvedExpr &expr);
+  std::optional<double> evaluateCall(const ResolvedCallExpr &call);
+
+public:
+  // Value of 'expr' with no variables in scope, calls to void functions
+  // evaluate to 0. The values println prints are appended to 'printed' if
+  // given, otherwise printing counts as a value only known at runtime.
+  std::optional<double> evaluateConstant(const ResolvedExpr &expr,
+                                         std::vector<double> *printed);
+};
+
+// Replaces the calls in 'module' that can be evaluated at compile time.
+// A call whose value is used becomes a number literal if it prints
+// nothing. A call statement becomes the println calls it would make, with
+// their arguments evaluated, or disappears if it prints nothing. The
+// effects of the functions and their integers are inferred again
+// afterwards.
+void evaluateConstantCalls(llvm::ArrayRef<ResolvedFunctionDecl *> module,
+                           Arena &arena);
+} // namespace hlx
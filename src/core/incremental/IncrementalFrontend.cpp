@@ -0,0 +1,517 @@
+#include "IncrementalFrontend.h"
+#include "../../utils/SourceManager.h"
+#include "../lexer/Lexer.h"
+#include "../parser/Parser.h"
+#include "../sema/Effects.h"
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <unordered_set>
+
+namespace hlx {
+struct IncrementalFrontend::Piece {
+  SourceFile source;
+  // Newlines in the text and the bytes after the last one.
+  uint32_t lineCount = 0;
+  uint32_t lastLineSize = 0;
+  // Identifiers in the piece, sorted by id.
+  std::vector<Symbol> names;
+
+  Arena astArena;
+  FunctionDecl *fn = nullptr;
+  std::vector<Diagnostic> parseDiagnostics;
+  bool incomplete = false;
+  // Parsing stops after this piece, at a stray top-level token or a '\0'.
+  bool endsInput = false;
+
+  std::unique_ptr<Arena> signatureArena;
+  ResolvedFunctionDecl *decl = nullptr;
+  std::vector<Diagnostic> signatureDiagnostics;
+
+  std::unique_ptr<Arena> bodyArena;
+  std::vector<Diagnostic> bodyDiagnostics;
+  bool bodyDirty = true;
+  bool bodyResolved = false;
+  std::vector<const ResolvedFunctionDecl *> callees;
+  bool hasLoop = false;
+
+  // Not behind the end of the input.
+  bool active = false;
+  // What the piece contributes to 'declarers' and 'signatureErrors'.
+  ResolvedFunctionDecl *declared = nullptr;
+  bool signatureError = false;
+
+  Piece(std::string_view path, std::string text)
+      : source{path, std::move(text)} {}
+  ~Piece() { SourceManager::get().removeFile(source); }
+};
+
+namespace {
+bool lessById(Symbol lhs, Symbol rhs) { return lhs.getId() < rhs.getId(); }
+
+void sortUnique(std::vector<Symbol> &symbols) {
+  std::sort(symbols.begin(), symbols.end(), lessById);
+  symbols.erase(std::unique(symbols.begin(), symbols.end()), symbols.end());
+}
+
+// Callers only depend on the name, the type and the parameter types.
+bool hasSameSignature(const ResolvedFunctionDecl &lhs,
+                      const ResolvedFunctionDecl &rhs) {
+  if (lhs.identifier != rhs.identifier || lhs.type != rhs.type ||
+      lhs.params.size() != rhs.params.size())
+    return false;
+
+  for (size_t i = 0; i < lhs.params.size(); ++i)
+    if (lhs.params[i]->type != rhs.params[i]->type)
+      return false;
+
+  return true;
+}
+
+// Diagnostics of lexing, parsing and resolving 'text' from scratch.
+std::string compile(std::string_view path, std::string text) {
+  SourceFile file{path, std::move(text)};
+  std::string diagnostics;
+  {
+    DiagnosticCapture capture;
+    Arena arena;
+    Lexer lexer(file);
+    auto [ast, success] = Parser(lexer, arena).parseSourceFile();
+    if (success) {
+      Sema sema(std::move(ast), arena);
+      sema.setCheckAll(true);
+      sema.resolveAST();
+    }
+    diagnostics = capture.take();
+  }
+
+  SourceManager::get().removeFile(file);
+  return diagnostics;
+}
+} // namespace
+
+IncrementalFrontend::IncrementalFrontend(std::string path,
+                                         std::string_view text)
+    : path(std::move(path)), sema({}, arena), globalScope(&sema),
+      println(sema.createBuiltinPrintln()) {
+  sema.insertDeclToCurrentScope(*println);
+  globals.emplace(symbols::println, println);
+  declarers[symbols::println].emplace_back(nullptr);
+
+  pieces.emplace_back(createPiece("", false));
+  applyEdit(0, 0, text);
+}
+
+IncrementalFrontend::~IncrementalFrontend() = default;
+
+std::unique_ptr<IncrementalFrontend::Piece>
+IncrementalFrontend::createPiece(std::string text, bool followedByFn) {
+  auto piece = std::make_unique<Piece>(path, std::move(text));
+  const std::string &buffer = piece->source.buffer;
+  piece->lineCount = std::count(buffer.begin(), buffer.end(), '\n');
+  piece->lastLineSize = buffer.size() - (buffer.rfind('\n') + 1);
+
+  Lexer lexer(piece->source);
+  TokenBuffer tokens(piece->source);
+  uint32_t end = SourceManager::get().addFile(piece->source) + buffer.size();
+  while (true) {
+    Token token = lexer.getNextToken();
+    if (token.kind == TokenKind::Identifier)
+      piece->names.emplace_back(token.symbol);
+
+    if (token.kind == TokenKind::Eof) {
+      piece->endsInput = token.location.offset != end;
+      // Like the 'fn' of the next piece in parseSourceFileParallel(), which
+      // is seen but never consumed.
+      if (followedByFn && !piece->endsInput)
+        token.kind = TokenKind::KwFn;
+      tokens.push(token);
+      break;
+    }
+
+    tokens.push(token);
+  }
+  sortUnique(piece->names);
+
+  {
+    DiagnosticCapture capture;
+    Parser parser(tokens, piece->astArena, 0, tokens.size() - 1);
+    auto [functions, success] = parser.parseSourceFile();
+    piece->fn = functions.empty() ? nullptr : functions.front();
+    piece->incomplete = !success;
+    piece->endsInput |= parser.hasStoppedAtTopLevel();
+    piece->parseDiagnostics = capture.takeDiagnostics();
+  }
+
+  if (piece->fn) {
+    piece->signatureArena = std::make_unique<Arena>();
+    sema.setArena(*piece->signatureArena);
+    DiagnosticCapture capture;
+    piece->decl = sema.resolveFunctionDeclaration(*piece->fn);
+    piece->signatureDiagnostics = capture.takeDiagnostics();
+  }
+
+  return piece;
+}
+
+void IncrementalFrontend::setDeclared(Piece &piece,
+                                      ResolvedFunctionDecl *decl) {
+  if (piece.declared == decl)
+    return;
+
+  if (ResolvedFunctionDecl *old = piece.declared) {
+    Symbol name = old->identifier;
+    std::vector<Piece *> &list = declarers[name];
+    list.erase(std::find(list.begin(), list.end(), &piece));
+    if (list.size() == 1)
+      --redeclaredNames;
+    if (list.empty())
+      declarers.erase(name);
+    pendingNames.emplace_back(name);
+  }
+
+  piece.declared = decl;
+  if (decl) {
+    std::vector<Piece *> &list = declarers[decl->identifier];
+    list.emplace_back(&piece);
+    if (list.size() == 2)
+      ++redeclaredNames;
+    pendingNames.emplace_back(decl->identifier);
+  }
+}
+
+void IncrementalFrontend::releaseGlobal(const ResolvedFunctionDecl &decl) {
+  auto global = globals.find(decl.identifier);
+  if (global == globals.end() || global->second != &decl)
+    return;
+
+  sema.removeGlobalDecl(decl);
+  globals.erase(global);
+  changedGlobals.emplace_back(decl.identifier);
+}
+
+void IncrementalFrontend::applyEdit(size_t begin, size_t end,
+                                    std::string_view text) {
+  std::vector<size_t> starts{0};
+  for (auto &&piece : pieces)
+    starts.emplace_back(starts.back() + piece->source.buffer.size());
+  assert(begin <= end && end <= starts.back() && "edit out of range");
+
+  auto pieceAt = [&](size_t offset) -> size_t {
+    return std::upper_bound(starts.begin() + 1, starts.end() - 1, offset) -
+           starts.begin() - 1;
+  };
+
+  // The edit can merge with the token in front of it, and since tokens never
+  // span lines, change how the rest of its last line is lexed. Pieces
+  // starting on a later line keep their tokens.
+  size_t first = pieceAt(begin ? begin - 1 : 0);
+  size_t last = pieceAt(end);
+  while (last + 1 < pieces.size() &&
+         pieces[last]->source.buffer.find(
+             '\n', std::max(end, starts[last]) - starts[last]) ==
+             std::string::npos)
+    ++last;
+
+  std::string region;
+  std::vector<size_t> splits;
+  while (true) {
+    region.clear();
+    for (size_t i = first; i <= last; ++i)
+      region += pieces[i]->source.buffer;
+    region.replace(begin - starts[first], end - begin, text);
+
+    SourceFile regionFile{path, std::move(region)};
+    uint32_t base = SourceManager::get().addFile(regionFile);
+    bool startsWithFn = false;
+    splits.assign(1, 0);
+    Lexer lexer(regionFile);
+    for (Token token = lexer.getNextToken(); token.kind != TokenKind::Eof;
+         token = lexer.getNextToken()) {
+      if (token.kind != TokenKind::KwFn)
+        continue;
+
+      if (size_t offset = token.location.offset - base)
+        splits.emplace_back(offset);
+      else
+        startsWithFn = true;
+    }
+    SourceManager::get().removeFile(regionFile);
+    region = std::move(regionFile.buffer);
+
+    if (first == 0 || startsWithFn)
+      break;
+    // The first piece lost its 'fn', what is left of it belongs to the piece
+    // in front.
+    --first;
+  }
+  splits.emplace_back(region.size());
+
+  bool endsDocument = last + 1 == pieces.size();
+  std::vector<std::unique_ptr<Piece>> created;
+  for (size_t i = 0; i + 1 < splits.size(); ++i)
+    created.emplace_back(
+        createPiece(region.substr(splits[i], splits[i + 1] - splits[i]),
+                    i + 2 < splits.size() || !endsDocument));
+
+  // A function that kept its signature keeps its declaration too, so the
+  // bodies resolved against it stay valid. Only positions in it moved.
+  for (auto &&piece : created) {
+    if (!piece->decl)
+      continue;
+
+    for (size_t i = first; i <= last; ++i) {
+      Piece &old = *pieces[i];
+      if (!old.decl || !hasSameSignature(*old.decl, *piece->decl))
+        continue;
+
+      ResolvedFunctionDecl *decl = old.decl;
+      decl->location = piece->decl->location;
+      for (size_t p = 0; p < decl->params.size(); ++p) {
+        decl->params[p]->location = piece->decl->params[p]->location;
+        decl->params[p]->identifier = piece->decl->params[p]->identifier;
+      }
+      decl->body = nullptr;
+
+      piece->decl = decl;
+      piece->signatureArena = std::move(old.signatureArena);
+      old.decl = nullptr;
+      if (old.declared == decl) {
+        std::vector<Piece *> &list = declarers[decl->identifier];
+        *std::find(list.begin(), list.end(), &old) = piece.get();
+        piece->declared = decl;
+        old.declared = nullptr;
+      }
+      break;
+    }
+  }
+
+  for (size_t i = first; i <= last; ++i) {
+    setDeclared(*pieces[i], nullptr);
+    signatureErrors -= pieces[i]->signatureError;
+    // Other declarations stay in the global scope until the next error-free
+    // update, this one cannot.
+    if (pieces[i]->decl)
+      releaseGlobal(*pieces[i]->decl);
+  }
+  pieces.erase(pieces.begin() + first, pieces.begin() + last + 1);
+  pieces.insert(pieces.begin() + first,
+                std::make_move_iterator(created.begin()),
+                std::make_move_iterator(created.end()));
+
+  update();
+}
+
+void IncrementalFrontend::update() {
+  bool inputEnded = false;
+  uint32_t line = 1;
+  uint32_t col = 1;
+  parsed = true;
+  for (auto &&piece : pieces) {
+    piece->active = !inputEnded;
+    if (piece->active) {
+      parsed &= !piece->incomplete;
+      inputEnded = piece->endsInput;
+    }
+
+    setDeclared(*piece, piece->active ? piece->decl : nullptr);
+    bool signatureError = piece->active && piece->fn && !piece->decl;
+    signatureErrors += signatureError;
+    signatureErrors -= piece->signatureError;
+    piece->signatureError = signatureError;
+
+    piece->source.firstLine = line;
+    piece->source.firstCol = col;
+    if (piece->lineCount) {
+      line += piece->lineCount;
+      col = piece->lastLineSize + 1;
+    } else {
+      col += piece->source.buffer.size();
+    }
+  }
+
+  // Sema only runs on error-free declarations, until then the global scope
+  // is left alone. A piece cut off by a stray token and restored keeps its
+  // declaration and so does not invalidate any body.
+  bool resolvable = parsed && !signatureErrors && !redeclaredNames;
+  if (resolvable) {
+    sortUnique(pendingNames);
+    for (auto &&name : pendingNames) {
+      ResolvedFunctionDecl *decl = nullptr;
+      if (auto it = declarers.find(name); it != declarers.end())
+        decl = it->second.front() ? it->second.front()->declared : println;
+
+      auto global = globals.find(name);
+      ResolvedFunctionDecl *current =
+          global == globals.end() ? nullptr : global->second;
+      if (decl == current)
+        continue;
+
+      if (current)
+        sema.removeGlobalDecl(*current);
+      if (decl) {
+        sema.insertDeclToCurrentScope(*decl);
+        globals[name] = decl;
+      } else {
+        globals.erase(global);
+      }
+      changedGlobals.emplace_back(name);
+    }
+    pendingNames.clear();
+  }
+
+  if (!changedGlobals.empty()) {
+    sortUnique(changedGlobals);
+    std::unordered_set<Symbol> changed;
+    if (changedGlobals.size() > 16)
+      changed.insert(changedGlobals.begin(), changedGlobals.end());
+
+    auto mentionsChanged = [&](const Piece &piece) {
+      if (changed.empty())
+        return std::any_of(
+            changedGlobals.begin(), changedGlobals.end(), [&](Symbol name) {
+              return std::binary_search(piece.names.begin(),
+                                        piece.names.end(), name, lessById);
+            });
+      return std::any_of(piece.names.begin(), piece.names.end(),
+                         [&](Symbol name) { return changed.count(name); });
+    };
+
+    for (auto &&piece : pieces)
+      if (!piece->bodyDirty && mentionsChanged(*piece))
+        piece->bodyDirty = true;
+    changedGlobals.clear();
+  }
+
+  if (!resolvable)
+    return;
+
+  for (auto &&piece : pieces) {
+    if (!piece->active || !piece->decl || !piece->bodyDirty)
+      continue;
+
+    piece->bodyArena = std::make_unique<Arena>();
+    sema.setArena(*piece->bodyArena);
+    DiagnosticCapture capture;
+    piece->bodyResolved = sema.resolveFunctionBody(*piece->decl, *piece->fn);
+    auto callees = sema.getCalledFunctions();
+    piece->callees.assign(callees.begin(), callees.end());
+    piece->hasLoop = sema.hasLoopInBody();
+    piece->bodyDiagnostics = capture.takeDiagnostics();
+    piece->bodyDirty = false;
+  }
+}
+
+std::string IncrementalFrontend::getText() const {
+  std::string text;
+  for (auto &&piece : pieces)
+    text += piece->source.buffer;
+  return text;
+}
+
+std::vector<Diagnostic> IncrementalFrontend::getDiagnostics() const {
+  std::vector<Diagnostic> diagnostics;
+  auto append = [&](const std::vector<Diagnostic> &from) {
+    diagnostics.insert(diagnostics.end(), from.begin(), from.end());
+  };
+
+  for (auto &&piece : pieces)
+    if (piece->active)
+      append(piece->parseDiagnostics);
+  if (!parsed)
+    return diagnostics;
+
+  if (signatureErrors || redeclaredNames) {
+    // Redeclarations depend on the order of the functions, replay them the
+    // way Sema::resolveAST() inserts them.
+    Arena scratch;
+    Sema declarations({}, scratch);
+    Sema::ScopeRAII scope{&declarations};
+    declarations.insertDeclToCurrentScope(*println);
+    for (auto &&piece : pieces) {
+      if (!piece->active || !piece->fn)
+        continue;
+
+      if (!piece->decl) {
+        append(piece->signatureDiagnostics);
+        continue;
+      }
+
+      DiagnosticCapture capture;
+      declarations.insertDeclToCurrentScope(*piece->decl);
+      append(capture.takeDiagnostics());
+    }
+    return diagnostics;
+  }
+
+  for (auto &&piece : pieces)
+    if (piece->active && piece->decl)
+      append(piece->bodyDiagnostics);
+  return diagnostics;
+}
+
+std::vector<ResolvedFunctionDecl *>
+IncrementalFrontend::getResolvedModule() const {
+  if (!parsed || signatureErrors || redeclaredNames)
+    return {};
+
+  std::vector<ResolvedFunctionDecl *> module{println};
+  std::vector<std::vector<const ResolvedFunctionDecl *>> callees(1);
+  std::vector<char> loops(1);
+  for (auto &&piece : pieces) {
+    if (!piece->active || !piece->decl)
+      continue;
+    if (!piece->bodyResolved)
+      return {};
+    module.emplace_back(piece->decl);
+    callees.emplace_back(piece->callees);
+    loops.emplace_back(piece->hasLoop);
+  }
+
+  inferEffects(module, callees, loops);
+  return Sema::selectReachable(module, callees);
+}
+
+bool verifyIncremental(const SourceFile &source) {
+  IncrementalFrontend frontend(std::string(source.path), source.buffer);
+  std::string text = source.buffer;
+  uint32_t base = SourceManager::get().addFile(source);
+
+  auto matches = [&](size_t offset) {
+    std::string diagnostics;
+    for (auto &&diagnostic : frontend.getDiagnostics())
+      diagnostics += formatDiagnostic(diagnostic);
+
+    if (frontend.getText() == text &&
+        diagnostics == compile(source.path, text))
+      return true;
+
+    report({static_cast<uint32_t>(base + offset)},
+           "incremental diagnostics mismatch");
+    return false;
+  };
+
+  if (!matches(0))
+    return false;
+
+  for (size_t lineStart = 0; lineStart < source.buffer.size();) {
+    size_t lineEnd = source.buffer.find('\n', lineStart);
+    lineEnd = lineEnd == std::string::npos ? source.buffer.size() : lineEnd + 1;
+    std::string line = source.buffer.substr(lineStart, lineEnd - lineStart);
+
+    frontend.applyEdit(lineStart, lineEnd, "");
+    text.erase(lineStart, line.size());
+    if (!matches(lineStart))
+      return false;
+
+    frontend.applyEdit(lineStart, lineStart, line);
+    text.insert(lineStart, line);
+    if (!matches(lineStart))
+      return false;
+
+    lineStart = lineEnd;
+  }
+
+  return true;
+}
+} // namespace hlx
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "../../utils/Arena.h"
+#include "../../utils/Interner.h"
+#include "../../utils/Utils.h"
+#include "../ast/ResolvedAst.h"
+#include "../sema/Sema.h"
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace hlx {
+// Front end of a document that is edited in place, e.g. by an editor. The
+// text is kept as pieces that each start at a 'fn' token, the first one at
+// the start of the document; the same split parseSourceFileParallel() uses.
+// Every piece is lexed as a file of its own, so its tokens, AST and
+// diagnostics stay valid when an edit in front of it shifts the text, only
+// its position in the document is updated.
+//
+// An edit re-lexes and re-parses the pieces it touches. A function whose
+// signature did not change keeps its resolved declaration, and a body is
+// only resolved again when its piece changed or a name it mentions now
+// refers to a different function. Every body is resolved, so the
+// diagnostics are always the ones a full compilation of the current text
+// reports with -fcheck-all.
+class IncrementalFrontend {
+  struct Piece;
+
+  std::string path;
+  std::vector<std::unique_ptr<Piece>> pieces;
+
+  // Owns println, the global scope stays open as long as the document.
+  Arena arena;
+  Sema sema;
+  Sema::ScopeRAII globalScope;
+  ResolvedFunctionDecl *println;
+
+  // Pieces declaring a valid function, by name. Null stands for println.
+  std::unordered_map<Symbol, std::vector<Piece *>> declarers;
+  size_t redeclaredNames = 0;
+  size_t signatureErrors = 0;
+  // Every piece up to the end of the input parsed without errors.
+  bool parsed = true;
+
+  // The function each name refers to in the global scope of 'sema'.
+  std::unordered_map<Symbol, ResolvedFunctionDecl *> globals;
+  // Names whose declarers changed since the global scope was updated.
+  std::vector<Symbol> pendingNames;
+  // Names whose global changed, bodies mentioning them are out of date.
+  std::vector<Symbol> changedGlobals;
+
+  std::unique_ptr<Piece> createPiece(std::string text, bool followedByFn);
+  void setDeclared(Piece &piece, ResolvedFunctionDecl *decl);
+  // Takes 'decl' out of the global scope before it is released.
+  void releaseGlobal(const ResolvedFunctionDecl &decl);
+  void update();
+
+public:
+  IncrementalFrontend(std::string path, std::string_view text);
+  ~IncrementalFrontend();
+  IncrementalFrontend(const IncrementalFrontend &) = delete;
+  IncrementalFrontend &operator=(const IncrementalFrontend &) = delete;
+
+  // Replaces the bytes in [begin, end) of the current text with 'text'.
+  void applyEdit(size_t begin, size_t end, std::string_view text);
+
+  std::string getText() const;
+  // In the order a full compilation reports them.
+  std::vector<Diagnostic> getDiagnostics() const;
+  // Same as Sema::resolveAST() on the current text with checkAll set,
+  // empty if there are errors. Valid until the next edit.
+  std::vector<ResolvedFunctionDecl *> getResolvedModule() const;
+};
+
+// Deletes and re-inserts every line of 'source', checking after each edit
+// that the diagnostics match the ones of a full compilation.
+bool verifyIncremental(const SourceFile &source);
+} // namespace hlx
@@ -1,5 +1,10 @@
 #include "Lexer.h"
+#include "../../utils/Parallel.h"
 #include "Token.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <vector>
 
 bool isSpace(char c) {
   return c == ' ' || c == '\f' || c == '\n' || c == '\r' || c == '\t' ||
@@ -14,21 +19,17 @@ bool isAlnum(char c) { return isAlpha(c) || isNum(c); }
 
 char hlx::Lexer::peekNextChar() const { return source->buffer[idx]; }
 
-char hlx::Lexer::eatNextChar() {
-  ++column;
-  if (source->buffer[idx] == '\n') {
-    ++line;
-    column = 0;
-  }
-  return source->buffer[idx++];
-}
+char hlx::Lexer::eatNextChar() { return source->buffer[idx++]; }
 
 hlx::Token hlx::Lexer::getNextToken() {
   char currentChar = eatNextChar();
   while (isSpace(currentChar)) {
     currentChar = eatNextChar();
   }
-  SourceLocation tokenStartLocation{source->path, line, column};
+  SourceLocation tokenStartLocation{static_cast<uint32_t>(base + idx - 1)};
+
+  if (idx - 1 >= end)
+    return Token{tokenStartLocation, TokenKind::Eof};
 
   if (currentChar == '>' && peekNextChar() == '=') {
     eatNextChar();
@@ -77,27 +78,129 @@ hlx::Token hlx::Lexer::getNextToken() {
   }
 
   if (isAlpha(currentChar)) {
-    std::string value{currentChar};
+    const char *first = source->buffer.data() + idx - 1;
     while (isAlnum(peekNextChar()))
-      value += eatNextChar();
+      eatNextChar();
 
-    if (keywords.count(value))
-      return Token{tokenStartLocation, keywords.at(value), std::move(value)};
-    return Token{tokenStartLocation, TokenKind::Identifier, std::move(value)};
+    std::string_view value(first, source->buffer.data() + idx - first);
+    if (auto keyword = keywords.find(value); keyword != keywords.end())
+      return Token{tokenStartLocation, keyword->second};
+    return Token{tokenStartLocation, TokenKind::Identifier,
+                 symbols->intern(value)};
   }
 
   if (isNum(currentChar)) {
-    std::string value{currentChar};
+    const char *first = source->buffer.data() + idx - 1;
     while (isNum(peekNextChar()))
-      value += eatNextChar();
-    if (peekNextChar() != '.')
-      return Token{tokenStartLocation, TokenKind::Number, value};
-    value += eatNextChar();
-    if (!isNum(peekNextChar()))
+      eatNextChar();
+    if (peekNextChar() == '.') {
+      eatNextChar();
+      if (!isNum(peekNextChar()))
+        return Token{tokenStartLocation, TokenKind::Unk};
+      while (isNum(peekNextChar()))
+        eatNextChar();
+    }
+
+    double value;
+    auto [last, ec] =
+        std::from_chars(first, source->buffer.data() + idx, value);
+    if (ec != std::errc())
       return Token{tokenStartLocation, TokenKind::Unk};
-    while (isNum(peekNextChar()))
-      value += eatNextChar();
-    return Token{tokenStartLocation, TokenKind::Number, value};
+
+    return Token{tokenStartLocation, TokenKind::Number, Symbol(),
+                 constants->intern(value)};
   }
   return Token{tokenStartLocation, TokenKind::Unk};
 }
+
+hlx::TokenBuffer hlx::Lexer::tokenize() {
+  TokenBuffer tokens(*source);
+
+  while (true) {
+    Token token = getNextToken();
+    tokens.push(token);
+
+    if (token.kind == TokenKind::Eof)
+      break;
+  }
+
+  return tokens;
+}
+
+hlx::TokenBuffer hlx::tokenizeParallel(const SourceFile &source, unsigned jobs,
+                                       size_t chunkSize) {
+  constexpr size_t minChunkSize = 1 << 16;
+  const std::string &buffer = source.buffer;
+  if (chunkSize == 0)
+    chunkSize = std::max(minChunkSize, buffer.size() / std::max(jobs, 1u));
+
+  // Every newline is a safe split point: no token spans lines and a '//'
+  // comment always ends at the newline. Locations are offsets into the
+  // SourceManager, so chunks need no line number fixups.
+  std::vector<size_t> bounds{0};
+  while (bounds.back() + chunkSize < buffer.size()) {
+    const char *newline = static_cast<const char *>(
+        std::memchr(buffer.data() + bounds.back() + chunkSize, '\n',
+                    buffer.size() - bounds.back() - chunkSize));
+    if (!newline)
+      break;
+    bounds.emplace_back(newline - buffer.data() + 1);
+  }
+  bounds.emplace_back(buffer.size());
+
+  size_t chunkCount = bounds.size() - 1;
+  std::vector<TokenBuffer> chunks;
+  chunks.reserve(chunkCount);
+  for (size_t i = 0; i < chunkCount; ++i)
+    chunks.emplace_back(source);
+
+  // Chunks intern their literals and identifiers into private tables, which
+  // are merged in source order so indices and symbols match sequential
+  // lexing.
+  std::vector<ConstantPool> constants(chunkCount);
+  std::vector<Interner> symbols(chunkCount);
+  parallelFor(chunkCount, jobs, [&](size_t i) {
+    chunks[i] = Lexer(source, bounds[i], bounds[i + 1], constants[i],
+                      symbols[i])
+                    .tokenize();
+  });
+
+  uint32_t base = SourceManager::get().addFile(source);
+  TokenBuffer tokens = std::move(chunks[0]);
+  tokens.remapConstants(constants[0], ConstantPool::get());
+  tokens.remapSymbols(symbols[0], Interner::get());
+  for (size_t i = 1; i < chunkCount; ++i) {
+    // A '\0' in the middle of the source ends sequential lexing early.
+    if (tokens.getLocation(tokens.size() - 1).offset < base + bounds[i])
+      break;
+
+    chunks[i].remapConstants(constants[i], ConstantPool::get());
+    chunks[i].remapSymbols(symbols[i], Interner::get());
+    tokens.append(std::move(chunks[i]));
+  }
+
+  return tokens;
+}
+
+bool hlx::verifyParallelTokenize(const SourceFile &source, unsigned jobs) {
+  Lexer lexer(source);
+  TokenBuffer tokens = tokenizeParallel(source, jobs, 1);
+
+  for (size_t idx = 0; idx < tokens.size(); ++idx) {
+    Token expected = lexer.getNextToken();
+    Token actual = tokens.getToken(idx);
+
+    if (expected.kind != actual.kind ||
+        expected.location.offset != actual.location.offset ||
+        expected.symbol != actual.symbol ||
+        expected.constant != actual.constant) {
+      report(actual.location, "parallel lexing mismatch");
+      return false;
+    }
+
+    if (expected.kind == TokenKind::Eof)
+      return idx + 1 == tokens.size();
+  }
+
+  return false;
+}
@@ -1,22 +1,47 @@
 #pragma once
+#include "../../utils/ConstantPool.h"
+#include "../../utils/Interner.h"
+#include "../../utils/SourceManager.h"
 #include "../../utils/Utils.h"
 #include "Token.h"
+#include "TokenBuffer.h"
 
 
 namespace hlx {
 
 class Lexer {
   const SourceFile *source;
+  ConstantPool *constants;
+  Interner *symbols;
+  uint32_t base;
   size_t idx = 0;
-  int line = 1;
-  int column = 0;
+  size_t end;
 
 private:
   char peekNextChar() const;
   char eatNextChar();
 
 public:
-  explicit Lexer(const SourceFile &source) : source(&source) {}
+  explicit Lexer(const SourceFile &source)
+      : Lexer(source, 0, source.buffer.size()) {}
+  // Lexes only the [begin, end) range, which has to start at the beginning
+  // of a line. Number literals are interned into 'constants', identifiers
+  // into 'symbols'.
+  Lexer(const SourceFile &source, size_t begin, size_t end,
+        ConstantPool &constants = ConstantPool::get(),
+        Interner &symbols = Interner::get())
+      : source(&source), constants(&constants), symbols(&symbols),
+        base(SourceManager::get().addFile(source)), idx(begin), end(end) {}
   Token getNextToken();
+  TokenBuffer tokenize();
 };
+
+// Splits the source into chunks of roughly chunkSize bytes at line
+// boundaries and lexes them on up to 'jobs' threads. The result is the same
+// as Lexer(source).tokenize(). A chunkSize of 0 picks one based on 'jobs'.
+TokenBuffer tokenizeParallel(const SourceFile &source, unsigned jobs,
+                             size_t chunkSize = 0);
+// Differential check of tokenizeParallel against sequential lexing, with
+// every line lexed as a separate chunk. Reports the first mismatch.
+bool verifyParallelTokenize(const SourceFile &source, unsigned jobs);
 } // namespace hlx
@@ -0,0 +1,33 @@
+#include "PipelinedLexer.h"
+
+hlx::PipelinedLexer::PipelinedLexer(const SourceFile &source, size_t capacity)
+    : queue(capacity), producer([this, &source]() {
+        Lexer lexer(source);
+
+        while (true) {
+          Token token = lexer.getNextToken();
+          bool isEof = token.kind == TokenKind::Eof;
+
+          while (!queue.tryPush(std::move(token))) {
+            if (stopped.load(std::memory_order_relaxed))
+              return;
+            std::this_thread::yield();
+          }
+
+          if (isEof)
+            return;
+        }
+      }) {}
+
+hlx::PipelinedLexer::~PipelinedLexer() {
+  stopped.store(true, std::memory_order_relaxed);
+  producer.join();
+}
+
+hlx::Token hlx::PipelinedLexer::getNextToken() {
+  Token token;
+  while (!queue.tryPop(token))
+    std::this_thread::yield();
+
+  return token;
+}
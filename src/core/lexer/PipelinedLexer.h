@@ -0,0 +1,24 @@
+#pragma once
+#include "../../utils/SpscQueue.h"
+#include "Lexer.h"
+#include "Token.h"
+#include <atomic>
+#include <thread>
+
+namespace hlx {
+
+// Runs a Lexer on its own thread, handing tokens to the parser through a
+// bounded SPSC ring so that lexing and parsing overlap. Destroying it stops
+// and joins the lexer thread.
+class PipelinedLexer {
+  SpscQueue<Token> queue;
+  std::atomic<bool> stopped = false;
+  std::thread producer;
+
+public:
+  explicit PipelinedLexer(const SourceFile &source, size_t capacity = 1024);
+  ~PipelinedLexer();
+
+  Token getNextToken();
+};
+} // namespace hlx
@@ -1,4 +1,5 @@
 #pragma once
+#include "../../utils/Interner.h"
 #include "../../utils/Utils.h"
 #include <optional>
 #include <unordered_map>
@@ -52,7 +53,10 @@ enum class TokenKind : char {
 struct Token {
   SourceLocation location;
   TokenKind kind;
-  std::optional<std::string> value = std::nullopt;
+  // Spelling of Identifier tokens.
+  Symbol symbol = symbols::empty;
+  // Index into the ConstantPool for Number tokens.
+  uint32_t constant = 0;
 };
 
 const std::unordered_map<std::string_view, TokenKind> keywords = {
@@ -0,0 +1,51 @@
+#include "TokenBuffer.h"
+#include "../../utils/SourceManager.h"
+
+hlx::TokenBuffer::TokenBuffer(const SourceFile &source)
+    : source(&source), base(SourceManager::get().addFile(source)) {}
+
+void hlx::TokenBuffer::push(const Token &token) {
+  uint32_t payload = 0;
+  if (token.kind == TokenKind::Identifier)
+    payload = token.symbol.getId();
+  else if (token.kind == TokenKind::Number)
+    payload = token.constant;
+
+  kinds.emplace_back(token.kind);
+  offsets.emplace_back(token.location.offset);
+  payloads.emplace_back(payload);
+}
+
+void hlx::TokenBuffer::append(TokenBuffer &&chunk) {
+  if (!kinds.empty() && kinds.back() == TokenKind::Eof) {
+    kinds.pop_back();
+    offsets.pop_back();
+    payloads.pop_back();
+  }
+
+  kinds.insert(kinds.end(), chunk.kinds.begin(), chunk.kinds.end());
+  offsets.insert(offsets.end(), chunk.offsets.begin(), chunk.offsets.end());
+  payloads.insert(payloads.end(), chunk.payloads.begin(), chunk.payloads.end());
+}
+
+void hlx::TokenBuffer::remapConstants(const ConstantPool &from,
+                                      ConstantPool &to) {
+  for (size_t i = 0; i < payloads.size(); ++i) {
+    if (kinds[i] == TokenKind::Number)
+      payloads[i] = to.intern(from.getValue(payloads[i]));
+  }
+}
+
+void hlx::TokenBuffer::remapSymbols(const Interner &from, Interner &to) {
+  for (size_t i = 0; i < payloads.size(); ++i) {
+    if (kinds[i] == TokenKind::Identifier)
+      payloads[i] = to.intern(from.getName(Symbol(payloads[i]))).getId();
+  }
+}
+
+std::optional<hlx::Symbol> hlx::TokenBuffer::getSymbol(size_t idx) const {
+  if (kinds[idx] != TokenKind::Identifier)
+    return std::nullopt;
+
+  return Symbol(payloads[idx]);
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "../../utils/ConstantPool.h"
+#include "../../utils/Interner.h"
+#include "../../utils/Utils.h"
+#include "Token.h"
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace hlx {
+
+// Structure-of-arrays storage for a fully lexed source file. Tokens are
+// addressed by index; payloads (symbols of identifiers, constant pool indices
+// of numbers) live in an array of their own, so reading any token is O(1).
+class TokenBuffer {
+  const SourceFile *source;
+  uint32_t base;
+
+  std::vector<TokenKind> kinds;
+  std::vector<uint32_t> offsets;
+
+  // Symbol ID or constant index, depending on the kind of the token, 0 for
+  // tokens without a payload.
+  std::vector<uint32_t> payloads;
+
+public:
+  explicit TokenBuffer(const SourceFile &source);
+
+  void push(const Token &token);
+  // Stitches the tokens of the chunk that directly follows this one,
+  // replacing the trailing Eof.
+  void append(TokenBuffer &&chunk);
+  // Moves the constants of number tokens lexed into 'from' over to 'to'.
+  void remapConstants(const ConstantPool &from, ConstantPool &to);
+  // Moves the symbols of identifier tokens lexed into 'from' over to 'to'.
+  void remapSymbols(const Interner &from, Interner &to);
+
+  size_t size() const { return kinds.size(); }
+  const SourceFile &getSource() const { return *source; }
+
+  TokenKind getKind(size_t idx) const { return kinds[idx]; }
+  SourceLocation getLocation(size_t idx) const { return {offsets[idx]}; }
+  std::optional<Symbol> getSymbol(size_t idx) const;
+
+  Token getToken(size_t idx) const {
+    Token token{getLocation(idx), kinds[idx]};
+    if (token.kind == TokenKind::Number)
+      token.constant = payloads[idx];
+    else if (token.kind == TokenKind::Identifier)
+      token.symbol = Symbol(payloads[idx]);
+
+    return token;
+  }
+};
+} // namespace hlx
@@ -1,10 +1,19 @@
 #include "Parser.h"
+#include "../../utils/Parallel.h"
+#include <algorithm>
 #include <cassert>
-#include <iostream>
 #include <memory>
 #include <utility>
 #include <vector>
 
+hlx::TokenKind hlx::Parser::peekTokenKind(size_t ahead) const {
+  assert(tokens && "lookahead requires a token buffer");
+  size_t idx = tokenIdx - 1 + ahead;
+  if (idx >= tokens->size())
+    return TokenKind::Eof;
+  return tokens->getKind(idx);
+}
+
 void hlx::Parser::synchronize(hlx::TokenKind kind) {
   inCompleteAST = true;
 
@@ -34,16 +43,16 @@ void hlx::Parser::synchronize(hlx::TokenKind kind) {
   }
 }
 
-std::pair<std::vector<std::unique_ptr<hlx::FunctionDecl>>, bool>
+std::pair<std::vector<hlx::FunctionDecl *>, bool>
 hlx::Parser::parseSourceFile() {
-  std::vector<std::unique_ptr<FunctionDecl>> functions;
+  std::vector<FunctionDecl *> functions;
 
-  while (nextToken.kind != TokenKind::Eof) {
+  while (!atEnd()) {
     if (nextToken.kind != TokenKind::KwFn) {
-      std::cerr<<(nextToken.kind==TokenKind::Rbrace);
       report(nextToken.location,
              "only function definitions are allowed on the top level");
       synchronize(TokenKind::KwFn);
+      stoppedAtTopLevel = true;
       break;
     }
 
@@ -53,18 +62,85 @@ hlx::Parser::parseSourceFile() {
       continue;
     }
 
-    functions.emplace_back(std::move(fn));
+    functions.emplace_back(fn);
+  }
+
+  return {functions, !inCompleteAST};
+}
+
+std::pair<std::vector<hlx::FunctionDecl *>, bool>
+hlx::Parser::parseSourceFileParallel(const TokenBuffer &tokens, Arena &arena,
+                                     unsigned jobs, bool lazyBodies) {
+  // Parsing a function never consumes a second 'fn': blocks, expressions and
+  // error recovery all stop in front of it. So every 'fn' starts an
+  // independent piece, and a piece that ends at the next 'fn' sees exactly
+  // the tokens the serial parser would.
+  std::vector<size_t> starts;
+  for (size_t i = 0; i < tokens.size(); ++i)
+    if (tokens.getKind(i) == TokenKind::KwFn)
+      starts.emplace_back(i);
+
+  if (jobs <= 1 || starts.empty() || starts.front() != 0)
+    return Parser(tokens, arena).setLazyBodies(lazyBodies).parseSourceFile();
+  starts.emplace_back(tokens.size() - 1);
+
+  struct Piece {
+    FunctionDecl *fn = nullptr;
+    std::vector<Diagnostic> diagnostics;
+    bool incomplete = false;
+    bool stopped = false;
+  };
+  size_t pieceCount = starts.size() - 1;
+  std::vector<Piece> pieces(pieceCount);
+
+  // Pieces are parsed in contiguous groups, each with its own arena, so a
+  // group of small functions shares slabs.
+  size_t groupCount = std::min<size_t>(pieceCount, jobs * 4);
+  std::vector<Arena> arenas(groupCount);
+  parallelFor(groupCount, jobs, [&](size_t group) {
+    size_t begin = pieceCount * group / groupCount;
+    size_t end = pieceCount * (group + 1) / groupCount;
+    for (size_t i = begin; i < end; ++i) {
+      DiagnosticCapture capture;
+      Parser parser(tokens, arenas[group], starts[i], starts[i + 1]);
+      auto [functions, success] =
+          parser.setLazyBodies(lazyBodies).parseSourceFile();
+
+      Piece &piece = pieces[i];
+      piece.fn = functions.empty() ? nullptr : functions.front();
+      piece.diagnostics = capture.takeDiagnostics();
+      piece.incomplete = !success;
+      piece.stopped = parser.stoppedAtTopLevel;
+      // Nothing after a stray top-level token is parsed.
+      if (piece.stopped)
+        break;
+    }
+  });
+
+  for (auto &&groupArena : arenas)
+    arena.adopt(std::move(groupArena));
+
+  std::vector<FunctionDecl *> functions;
+  bool success = true;
+  for (auto &&piece : pieces) {
+    for (auto &&diagnostic : piece.diagnostics)
+      report(diagnostic.location, diagnostic.message, diagnostic.isWarning);
+    if (piece.fn)
+      functions.emplace_back(piece.fn);
+    success &= !piece.incomplete;
+    if (piece.stopped)
+      break;
   }
 
-  return {std::move(functions), !inCompleteAST};
+  return {functions, success};
 }
 //<functionDecl>
 //::= 'fn' <ident> '(' ')' ':' <type> <block>
-std::unique_ptr<hlx::FunctionDecl> hlx::Parser::parseFunctionDecl() {
+hlx::FunctionDecl *hlx::Parser::parseFunctionDecl() {
   SourceLocation location = nextToken.location;
   eatNextToken();
   matchOrReturn(TokenKind::Identifier, "expected identifier");
-  std::string functionIdentifier = *nextToken.value;
+  Symbol functionIdentifier = nextToken.symbol;
   eatNextToken();
 
   varOrReturn(parameterList, parseParameterList());
@@ -75,11 +151,49 @@ std::unique_ptr<hlx::FunctionDecl> hlx::Parser::parseFunctionDecl() {
   varOrReturn(type, parseType());
 
   matchOrReturn(TokenKind::Lbrace, "expected function body");
+  if (std::optional<size_t> bodyEnd = findBodyEnd()) {
+    auto *fn = arena->make<FunctionDecl>(location, functionIdentifier, *type,
+                                         nullptr,
+                                         arena->copyArray(*parameterList));
+    fn->bodyBegin = tokenIdx - 1;
+    fn->bodyEnd = *bodyEnd;
+
+    tokenIdx = *bodyEnd;
+    eatNextToken(); // skip the body
+    return fn;
+  }
+
   varOrReturn(block, parseBlock());
 
-  return std::make_unique<FunctionDecl>(location, functionIdentifier, *type,
-                                        std::move(block),
-                                        std::move(*parameterList));
+  return arena->make<FunctionDecl>(location, functionIdentifier, *type, block,
+                                   arena->copyArray(*parameterList));
+}
+
+std::optional<size_t> hlx::Parser::findBodyEnd() const {
+  if (!lazyBodies || !tokens)
+    return std::nullopt;
+
+  // Bodies that would not parse up to a matching '}' are parsed right away,
+  // so their errors and the recovery after them stay the same.
+  int braces = 0;
+  for (size_t idx = tokenIdx - 1; idx < tokenEnd; ++idx) {
+    TokenKind kind = tokens->getKind(idx);
+    if (kind == TokenKind::Lbrace)
+      ++braces;
+    else if (kind == TokenKind::Rbrace && --braces == 0)
+      return idx + 1;
+    else if (kind == TokenKind::KwFn || kind == TokenKind::Eof)
+      break;
+  }
+
+  return std::nullopt;
+}
+
+hlx::Block *hlx::Parser::parseDeferredBody(const TokenBuffer &tokens,
+                                          Arena &arena, FunctionDecl &fn) {
+  if (!fn.body)
+    fn.body = Parser(tokens, arena, fn.bodyBegin, fn.bodyEnd).parseBlock();
+  return fn.body;
 }
 
 std::optional<hlx::Type> hlx::Parser::parseType() {
@@ -94,7 +208,7 @@ std::optional<hlx::Type> hlx::Parser::parseType() {
     return Type::builtinNumber();
   }
   if (kind == TokenKind::Identifier) {
-    auto t = Type::custom(*nextToken.value);
+    auto t = Type::custom(nextToken.symbol);
     eatNextToken();
     return t;
   }
@@ -102,11 +216,11 @@ std::optional<hlx::Type> hlx::Parser::parseType() {
   return std::nullopt;
 }
 
-std::unique_ptr<hlx::Block> hlx::Parser::parseBlock() {
+hlx::Block *hlx::Parser::parseBlock() {
   SourceLocation location = nextToken.location;
   eatNextToken(); // eat '{'
 
-  std::vector<std::unique_ptr<Stmt>> statements;
+  std::vector<Stmt *> statements;
   while (true) {
     if (nextToken.kind == TokenKind::Rbrace)
       break;
@@ -116,18 +230,18 @@ std::unique_ptr<hlx::Block> hlx::Parser::parseBlock() {
     }
 
     varOrReturn(stmt, parseStmt());
-    statements.emplace_back(std::move(stmt));
+    statements.emplace_back(stmt);
   }
   matchOrReturn(TokenKind::Rbrace, "expected '}' at the end of a block");
   eatNextToken(); // eat '}'
 
-  return std::make_unique<Block>(location, std::move(statements));
+  return arena->make<Block>(location, arena->copyArray(statements));
 }
 
-std::unique_ptr<hlx::ReturnStmt> hlx::Parser::parseReturnStmt() {
+hlx::ReturnStmt *hlx::Parser::parseReturnStmt() {
   SourceLocation location = nextToken.location;
   eatNextToken(); // eat return
-  std::unique_ptr<Expr> expr;
+  Expr *expr = nullptr;
   if (nextToken.kind != TokenKind::Semi) {
     expr = parseExpr();
     if (!expr)
@@ -136,10 +250,10 @@ std::unique_ptr<hlx::ReturnStmt> hlx::Parser::parseReturnStmt() {
   matchOrReturn(TokenKind::Semi,
                 "expected ';' at the end of a return statement");
   eatNextToken();
-  return std::make_unique<ReturnStmt>(location, std::move(expr));
+  return arena->make<ReturnStmt>(location, expr);
 }
 
-std::unique_ptr<hlx::IfStmt> hlx::Parser::parseIfStmt() {
+hlx::IfStmt *hlx::Parser::parseIfStmt() {
   SourceLocation location = nextToken.location;
   eatNextToken(); // eat if
 
@@ -149,18 +263,17 @@ std::unique_ptr<hlx::IfStmt> hlx::Parser::parseIfStmt() {
 
   varOrReturn(trueBlock, parseBlock());
   if (nextToken.kind != TokenKind::KwElse)
-    return std::make_unique<IfStmt>(location, std::move(condition),
-                                    std::move(trueBlock));
+    return arena->make<IfStmt>(location, condition, trueBlock);
 
   eatNextToken(); // eat else
-  std::unique_ptr<Block> falseBlock;
+  Block *falseBlock = nullptr;
   if (nextToken.kind == TokenKind::KwIf) {
     varOrReturn(elseIf, parseIfStmt());
     SourceLocation loc = elseIf->location;
-    std::vector<std::unique_ptr<Stmt>> stmts;
-    stmts.emplace_back(std::move(elseIf));
+    std::vector<Stmt *> stmts;
+    stmts.emplace_back(elseIf);
 
-    falseBlock = std::make_unique<Block>(loc, std::move(stmts));
+    falseBlock = arena->make<Block>(loc, arena->copyArray(stmts));
   } else {
     matchOrReturn(TokenKind::Lbrace, "expected else body");
     falseBlock = parseBlock();
@@ -168,11 +281,10 @@ std::unique_ptr<hlx::IfStmt> hlx::Parser::parseIfStmt() {
   if (!falseBlock)
     return nullptr;
 
-  return std::make_unique<IfStmt>(location, std::move(condition),
-                                  std::move(trueBlock), std::move(falseBlock));
+  return arena->make<IfStmt>(location, condition, trueBlock, falseBlock);
 }
 
-std::unique_ptr<hlx::WhileStmt> hlx::Parser::parseWhileStmt(){
+hlx::WhileStmt *hlx::Parser::parseWhileStmt(){
   SourceLocation location=nextToken.location;
   eatNextToken();
 
@@ -182,10 +294,10 @@ std::unique_ptr<hlx::WhileStmt> hlx::Parser::parseWhileStmt(){
 
   varOrReturn(body, parseBlock());
 
-  return std::make_unique<WhileStmt>(location,std::move(cond),std::move(body));
+  return arena->make<WhileStmt>(location,cond,body);
 }
 
-std::unique_ptr<hlx::Stmt> hlx::Parser::parseStmt() {
+hlx::Stmt *hlx::Parser::parseStmt() {
   if (nextToken.kind == TokenKind::KwIf)
     return parseIfStmt();
   if(nextToken.kind==TokenKind::KwWhile)
@@ -200,11 +312,11 @@ std::unique_ptr<hlx::Stmt> hlx::Parser::parseStmt() {
   return parseAssignmentOrExpr();
 }
 
-std::unique_ptr<hlx::Stmt> hlx::Parser::parseAssignmentOrExpr(){
+hlx::Stmt *hlx::Parser::parseAssignmentOrExpr(){
   varOrReturn(lhs, parsePrefixExpr());
 
   if(nextToken.kind!=TokenKind::Equal){
-    varOrReturn(expr, parseExprRHS(std::move(lhs), 0));
+    varOrReturn(expr, parseExprRHS(lhs));
 
     matchOrReturn(TokenKind::Semi, "expected ';' at the end of expression");
     eatNextToken();
@@ -212,28 +324,26 @@ std::unique_ptr<hlx::Stmt> hlx::Parser::parseAssignmentOrExpr(){
     return expr;
   }
 
-  auto *dre=dynamic_cast<DeclRefExpr *>(lhs.get());
+  auto *dre=llvm::dyn_cast<DeclRefExpr>(lhs);
   if(!dre)
     return report(lhs->location, "expected variable on LHS of assignment");
 
-  std::ignore=lhs.release();
-
-  varOrReturn(assignment, parseAssignmentRHS(std::unique_ptr<DeclRefExpr>(dre)));
+  varOrReturn(assignment, parseAssignmentRHS(dre));
   matchOrReturn(TokenKind::Semi, "expected ';' at the end of assignment");
   eatNextToken(); // eat ';'
 
   return assignment;
 }
 
-std::unique_ptr<hlx::Assignment> hlx::Parser::parseAssignmentRHS(std::unique_ptr<DeclRefExpr> lhs){
+hlx::Assignment *hlx::Parser::parseAssignmentRHS(DeclRefExpr *lhs){
   SourceLocation location=nextToken.location;
   eatNextToken();//eat =
 
   varOrReturn(rhs, parseExpr());
 
-  return std::make_unique<Assignment>(location, std::move(lhs), std::move(rhs));
+  return arena->make<Assignment>(location, lhs, rhs);
 }
-std::unique_ptr<hlx::DeclStmt> hlx::Parser::parseDeclStmt(){
+hlx::DeclStmt *hlx::Parser::parseDeclStmt(){
   Token tok=nextToken;
   eatNextToken();
 
@@ -243,14 +353,14 @@ std::unique_ptr<hlx::DeclStmt> hlx::Parser::parseDeclStmt(){
   matchOrReturn(TokenKind::Semi, "expected ';' after declaration");
   eatNextToken();
 
-  return std::make_unique<DeclStmt>(tok.location,std::move(varDecl));
+  return arena->make<DeclStmt>(tok.location,varDecl);
 }
 
-std::unique_ptr<hlx::VarDecl> hlx::Parser::parseVarDecl(bool isLet){
+hlx::VarDecl *hlx::Parser::parseVarDecl(bool isLet){
   
   SourceLocation location=nextToken.location;
 
-  std::string identifier=*nextToken.value;
+  Symbol identifier=nextToken.symbol;
   eatNextToken();
 
   std::optional<Type> type;
@@ -264,105 +374,171 @@ std::unique_ptr<hlx::VarDecl> hlx::Parser::parseVarDecl(bool isLet){
   }
 
   if(nextToken.kind!=TokenKind::Equal)
-    return std::make_unique<VarDecl>(location,identifier,type,!isLet);
+    return arena->make<VarDecl>(location,identifier,type,!isLet);
   eatNextToken();
 
   varOrReturn(initializer, parseExpr());
 
-  return std::make_unique<VarDecl>(location,identifier,type,!isLet,std::move(initializer));
+  return arena->make<VarDecl>(location,identifier,type,!isLet,initializer);
 }
 
-std::unique_ptr<hlx::Expr> hlx::Parser::parsePrimary() {
-  SourceLocation location = nextToken.location;
-
-  if (nextToken.kind == TokenKind::Lpar) {
-    eatNextToken(); // eat '('
-
-    varOrReturn(expr, parseExpr());
+hlx::Expr *hlx::Parser::parseExpr() { return parseExpression(nullptr, false); }
 
-    matchOrReturn(TokenKind::Rpar, "expected ')'");
-    eatNextToken(); // eat ')'
+hlx::Expr *hlx::Parser::parseExprRHS(Expr *lhs) {
+  return parseExpression(lhs, false);
+}
 
-    return std::make_unique<GroupingExpr>(location, std::move(expr));
-  }
+hlx::Expr *hlx::Parser::parsePrefixExpr() {
+  return parseExpression(nullptr, true);
+}
 
-  if (nextToken.kind == TokenKind::Number) {
-    auto literal = std::make_unique<NumberLiteral>(location, *nextToken.value);
-    eatNextToken(); // eat NumberLiteral
-    return literal;
-  }
+// Operator-precedence (shunting-yard) parser. Nesting is tracked on the
+// 'operators' stack instead of the call stack, so arbitrarily deep
+// expressions parse in linear time:
+//
+//   <expr> ::= <prefixExpr> (<binaryOp> <prefixExpr>)*
+//   <prefixExpr> ::= ('!' | '-')* <primary>
+//   <primary> ::= <number> | <ident> | <ident> <argList> | '(' <expr> ')'
+//   <argList> ::= '(' (<expr> (',' <expr>)* ','?)? ')'
+//
+// Binary operators are left associative and ranked by getTokPrecedence().
+// If 'lhs' is given it is the first operand, with 'prefixOnly' parsing stops
+// after the first complete <prefixExpr>.
+hlx::Expr *hlx::Parser::parseExpression(Expr *lhs, bool prefixOnly) {
+  enum class Frame { Unary, Binary, Paren, Call };
+  struct Operator {
+    Frame frame;
+    TokenKind op;
+    SourceLocation location;
+    // Call: the callee and the operand stack size before its arguments.
+    DeclRefExpr *callee = nullptr;
+    size_t firstArg = 0;
+  };
+
+  std::vector<Operator> operators;
+  std::vector<Expr *> operands;
+
+  auto reduceBinary = [&]() {
+    Operator binop = operators.back();
+    operators.pop_back();
+    Expr *rhs = operands.back();
+    operands.pop_back();
+    operands.back() = arena->make<BinaryOperator>(
+        binop.location, operands.back(), rhs, binop.op);
+  };
+  auto closeCall = [&]() {
+    Operator call = operators.back();
+    operators.pop_back();
+    std::vector<Expr *> args(operands.begin() + call.firstArg, operands.end());
+    operands.resize(call.firstArg);
+    operands.emplace_back(arena->make<CallExpr>(call.location, call.callee,
+                                                arena->copyArray(args)));
+  };
+
+  bool expectOperand = !lhs;
+  if (lhs)
+    operands.emplace_back(lhs);
 
-  if (nextToken.kind == TokenKind::Identifier) {
-    auto declRefExpr =
-        std::make_unique<DeclRefExpr>(location, *nextToken.value);
-    eatNextToken(); // eat identifier
+  while (true) {
+    if (expectOperand) {
+      SourceLocation location = nextToken.location;
+      TokenKind kind = nextToken.kind;
+
+      if (kind == TokenKind::Excl || kind == TokenKind::Minus) {
+        operators.push_back({Frame::Unary, kind, location});
+        eatNextToken();
+        continue;
+      }
 
-    if (nextToken.kind != TokenKind::Lpar)
-      return declRefExpr;
+      if (kind == TokenKind::Lpar) {
+        operators.push_back({Frame::Paren, kind, location});
+        eatNextToken(); // eat '('
+        continue;
+      }
 
-    location = nextToken.location;
+      if (kind == TokenKind::Number) {
+        operands.emplace_back(
+            arena->make<NumberLiteral>(location, nextToken.constant));
+        eatNextToken(); // eat NumberLiteral
+      } else if (kind == TokenKind::Identifier) {
+        auto *declRefExpr =
+            arena->make<DeclRefExpr>(location, nextToken.symbol);
+        eatNextToken(); // eat identifier
+
+        if (nextToken.kind != TokenKind::Lpar) {
+          operands.emplace_back(declRefExpr);
+        } else {
+          operators.push_back({Frame::Call, TokenKind::Lpar,
+                               nextToken.location, declRefExpr,
+                               operands.size()});
+          eatNextToken(); // eat '('
+          if (nextToken.kind != TokenKind::Rpar)
+            continue;
+          eatNextToken(); // eat ')'
+          closeCall();
+        }
+      } else {
+        return report(location, "expected expression");
+      }
 
-    varOrReturn(argumentList, parseArgumentList());
+      expectOperand = false;
+    }
 
-    return std::make_unique<CallExpr>(location, std::move(declRefExpr),
-                                      std::move(*argumentList));
-  }
+    // An operand is complete, unary operators bind tighter than anything
+    // that can follow it.
+    while (!operators.empty() && operators.back().frame == Frame::Unary) {
+      operands.back() = arena->make<UnaryOperator>(
+          operators.back().location, operands.back(), operators.back().op);
+      operators.pop_back();
+    }
 
-  return report(location, "expected expression");
-}
+    if (prefixOnly && operators.empty())
+      return operands.back();
 
-std::unique_ptr<std::vector<std::unique_ptr<hlx::Expr>>>
-hlx::Parser::parseArgumentList() {
-  matchOrReturn(TokenKind::Lpar, "expected '('");
-  eatNextToken(); // eat (
-  std::vector<std::unique_ptr<Expr>> argumentList;
-  while (true) {
-    if (nextToken.kind == TokenKind::Rpar)
-      break;
-    varOrReturn(expr, parseExpr());
-    argumentList.emplace_back(std::move(expr));
+    // With 'prefixOnly' this is inside parentheses or an argument list.
+    int precedence = getTokPrecedence(nextToken.kind);
+    if (precedence >= 0) {
+      while (!operators.empty() && operators.back().frame == Frame::Binary &&
+             getTokPrecedence(operators.back().op) >= precedence)
+        reduceBinary();
 
-    if (nextToken.kind != TokenKind::Comma)
-      break;
-    eatNextToken(); // eat ','
-  }
-  matchOrReturn(TokenKind::Rpar, "expected ')'");
-  eatNextToken(); // eat ')'
+      operators.push_back({Frame::Binary, nextToken.kind, nextToken.location});
+      eatNextToken();
+      expectOperand = true;
+      continue;
+    }
 
-  return std::make_unique<std::vector<std::unique_ptr<Expr>>>(
-      std::move(argumentList));
-}
+    while (!operators.empty() && operators.back().frame == Frame::Binary)
+      reduceBinary();
 
-std::unique_ptr<hlx::Expr> hlx::Parser::parseExpr() {
-  varOrReturn(lhs, parsePrefixExpr());
-  return parseExprRHS(std::move(lhs), 0);
-}
+    if (operators.empty())
+      return operands.back();
 
-std::unique_ptr<hlx::Expr> hlx::Parser::parseExprRHS(std::unique_ptr<Expr> lhs,
-                                                     int precedence) {
-  while (true) {
-    Token op = nextToken;
-    int curOpPrec = getTokPrecedence(op.kind);
+    if (operators.back().frame == Frame::Call &&
+        nextToken.kind == TokenKind::Comma) {
+      eatNextToken(); // eat ','
+      if (nextToken.kind != TokenKind::Rpar) {
+        expectOperand = true;
+        continue;
+      }
+    }
 
-    if (curOpPrec < precedence)
-      return lhs;
+    matchOrReturn(TokenKind::Rpar, "expected ')'");
+    eatNextToken(); // eat ')'
 
-    eatNextToken();
-    varOrReturn(rhs, parsePrefixExpr());
-    if (curOpPrec < getTokPrecedence(nextToken.kind)) {
-      rhs = parseExprRHS(std::move(rhs), curOpPrec + 1);
-      if (!rhs)
-        return nullptr;
+    if (operators.back().frame == Frame::Call) {
+      closeCall();
+    } else {
+      operands.back() =
+          arena->make<GroupingExpr>(operators.back().location, operands.back());
+      operators.pop_back();
     }
-
-    lhs = std::make_unique<BinaryOperator>(op.location, std::move(lhs),
-                                           std::move(rhs), op.kind);
   }
 }
 
-std::unique_ptr<hlx::ParamDecl> hlx::Parser::parseParamDecl() {
+hlx::ParamDecl *hlx::Parser::parseParamDecl() {
   SourceLocation location = nextToken.location;
-  std::string identifier = *nextToken.value;
+  Symbol identifier = nextToken.symbol;
   eatNextToken(); // eat ident
 
   matchOrReturn(TokenKind::Colon, "expected ':'");
@@ -370,15 +546,14 @@ std::unique_ptr<hlx::ParamDecl> hlx::Parser::parseParamDecl() {
 
   varOrReturn(type, parseType());
 
-  return std::make_unique<hlx::ParamDecl>(location, std::move(identifier),
-                                          std::move(*type));
+  return arena->make<ParamDecl>(location, identifier, *type);
 }
 
-std::unique_ptr<std::vector<std::unique_ptr<hlx::ParamDecl>>>
+std::unique_ptr<std::vector<hlx::ParamDecl *>>
 hlx::Parser::parseParameterList() {
   matchOrReturn(TokenKind::Lpar, "expected '('");
   eatNextToken(); // eat '('
-  std::vector<std::unique_ptr<ParamDecl>> parameterList;
+  std::vector<ParamDecl *> parameterList;
 
   while (true) {
     if (nextToken.kind == TokenKind::Rpar)
@@ -387,7 +562,7 @@ hlx::Parser::parseParameterList() {
     matchOrReturn(TokenKind::Identifier, "expected parameter declaration");
 
     varOrReturn(paramDecl, parseParamDecl());
-    parameterList.emplace_back(std::move(paramDecl));
+    parameterList.emplace_back(paramDecl);
 
     if (nextToken.kind != TokenKind::Comma)
       break;
@@ -396,8 +571,7 @@ hlx::Parser::parseParameterList() {
   matchOrReturn(TokenKind::Rpar, "expected ')'");
   eatNextToken(); // eat ')'
 
-  return std::make_unique<std::vector<std::unique_ptr<ParamDecl>>>(
-      std::move(parameterList));
+  return std::make_unique<std::vector<ParamDecl *>>(std::move(parameterList));
 }
 
 int hlx::Parser::getTokPrecedence(hlx::TokenKind tok) {
@@ -424,17 +598,4 @@ int hlx::Parser::getTokPrecedence(hlx::TokenKind tok) {
   default:
     return -1;
   }
-}
-
-std::unique_ptr<hlx::Expr> hlx::Parser::parsePrefixExpr() {
-  Token tok = nextToken;
-
-  if (tok.kind != TokenKind::Excl && tok.kind != TokenKind::Minus)
-    return parsePrimary();
-  eatNextToken();
-
-  varOrReturn(rhs, parsePrefixExpr());
-
-  return std::make_unique<UnaryOperator>(tok.location, std::move(rhs),
-                                         tok.kind);
 }
\ No newline at end of file
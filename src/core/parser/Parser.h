@@ -2,44 +2,112 @@
 #include <memory>
 #include <optional>
 #include <vector>
+#include "../../utils/Arena.h"
 #include "../ast/Ast.h"
 #include "../lexer/Lexer.h"
+#include "../lexer/PipelinedLexer.h"
 
 namespace hlx{
     class Parser{
-        Lexer *lexer;
+        Arena *arena;
+        Lexer *lexer=nullptr;
+        PipelinedLexer *pipeline=nullptr;
+        const TokenBuffer *tokens=nullptr;
+        size_t tokenIdx=0;
+        // Index of the last buffered token this parser may consume.
+        size_t tokenEnd=0;
         Token nextToken;
         bool inCompleteAST=false;
+        // Set when something other than a function was found on the top
+        // level, parsing does not continue past it.
+        bool stoppedAtTopLevel=false;
+        bool lazyBodies=false;
 
-        void eatNextToken(){nextToken=lexer->getNextToken();}
+        void eatNextToken(){
+            if(pipeline){
+                // The lexer thread stops after Eof.
+                if(nextToken.kind!=TokenKind::Eof)
+                    nextToken=pipeline->getNextToken();
+                return;
+            }
+            if(!tokens){
+                nextToken=lexer->getNextToken();
+                return;
+            }
+            if(tokenIdx<=tokenEnd)
+                nextToken=tokens->getToken(tokenIdx++);
+        }
+        bool atEnd() const{
+            return nextToken.kind==TokenKind::Eof ||
+                   (tokens && tokenIdx-1==tokenEnd);
+        }
         void synchronize(TokenKind kind);
+        std::optional<size_t> findBodyEnd() const;
 
     public:
-        explicit Parser(Lexer &lexer)
-        : lexer(&lexer),
+        // Nodes of the parsed tree are allocated in 'arena'.
+        Parser(Lexer &lexer,Arena &arena)
+        : arena(&arena),
+          lexer(&lexer),
           nextToken(lexer.getNextToken()){}
-        std::unique_ptr<ReturnStmt> parseReturnStmt();
-        std::unique_ptr<Stmt> parseStmt();
-        std::unique_ptr<FunctionDecl> parseFunctionDecl();
-        std::unique_ptr<IfStmt> parseIfStmt();
-        std::unique_ptr<WhileStmt> parseWhileStmt();
+        Parser(PipelinedLexer &pipeline,Arena &arena)
+        : arena(&arena),
+          pipeline(&pipeline),
+          nextToken(pipeline.getNextToken()){}
+        Parser(const TokenBuffer &tokens,Arena &arena)
+        : Parser(tokens,arena,0,tokens.size()-1){}
+        // Parses the tokens in [begin, end), the token at 'end' is seen
+        // but never consumed, just like Eof.
+        Parser(const TokenBuffer &tokens,Arena &arena,size_t begin,size_t end)
+        : arena(&arena),
+          tokens(&tokens),
+          tokenIdx(begin+1),
+          tokenEnd(end),
+          nextToken(tokens.getToken(begin)){}
+
+        // Splits 'tokens' at every 'fn' and parses the pieces on up to
+        // 'jobs' threads. The functions and diagnostics are the same, and
+        // in the same order, as the ones parseSourceFile() produces.
+        static std::pair<std::vector<FunctionDecl *>,bool>
+        parseSourceFileParallel(const TokenBuffer &tokens,Arena &arena,unsigned jobs,bool lazyBodies=false);
+
+        // When parsing from a TokenBuffer, only record the token range of
+        // function bodies with balanced braces, they are parsed by
+        // parseDeferredBody() the first time they are needed. Syntax errors
+        // in them are reported at that point.
+        Parser &setLazyBodies(bool lazy){
+            lazyBodies=lazy;
+            return *this;
+        }
+        static Block *parseDeferredBody(const TokenBuffer &tokens,Arena &arena,FunctionDecl &fn);
+        // Whether the last parseSourceFile() gave up at a stray top-level
+        // token, nothing after it was parsed.
+        bool hasStoppedAtTopLevel() const{return stoppedAtTopLevel;}
+
+        // Kind of the token 'ahead' positions after nextToken, only
+        // available when parsing from a TokenBuffer.
+        TokenKind peekTokenKind(size_t ahead) const;
+        ReturnStmt *parseReturnStmt();
+        Stmt *parseStmt();
+        FunctionDecl *parseFunctionDecl();
+        IfStmt *parseIfStmt();
+        WhileStmt *parseWhileStmt();
         std::optional<Type> parseType();
-        std::unique_ptr<Block> parseBlock();
-        std::unique_ptr<Expr> parsePrimary();
-        std::unique_ptr<Expr> parseExpr();
-        std::unique_ptr<DeclStmt> parseDeclStmt();
-        std::unique_ptr<VarDecl> parseVarDecl(bool isLet);
-        std::unique_ptr<ParamDecl> parseParamDecl();
-        std::unique_ptr<Stmt> parseAssignmentOrExpr();
-        std::unique_ptr<Assignment> parseAssignmentRHS(std::unique_ptr<DeclRefExpr> lhs);
-        std::unique_ptr<std::vector<std::unique_ptr<ParamDecl>>>
+        Block *parseBlock();
+        Expr *parseExpr();
+        DeclStmt *parseDeclStmt();
+        VarDecl *parseVarDecl(bool isLet);
+        ParamDecl *parseParamDecl();
+        Stmt *parseAssignmentOrExpr();
+        Assignment *parseAssignmentRHS(DeclRefExpr *lhs);
+        std::unique_ptr<std::vector<ParamDecl *>>
         parseParameterList();
-        std::unique_ptr<std::vector<std::unique_ptr<Expr>>>
-        parseArgumentList();
-        std::pair<std::vector<std::unique_ptr<FunctionDecl>>,bool> parseSourceFile();
+        std::pair<std::vector<FunctionDecl *>,bool> parseSourceFile();
 
         int getTokPrecedence(TokenKind tok);
-        std::unique_ptr<Expr> parseExprRHS(std::unique_ptr<Expr> lhs,int precedence);
-        std::unique_ptr<Expr> parsePrefixExpr();
+        // Binary operators and their operands following 'lhs'.
+        Expr *parseExprRHS(Expr *lhs);
+        Expr *parsePrefixExpr();
+        Expr *parseExpression(Expr *lhs,bool prefixOnly);
     };
 }
\ No newline at end of file
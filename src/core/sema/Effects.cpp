@@ -0,0 +1,69 @@
+#include "Effects.h"
+#include <algorithm>
+#include <cstddef>
+#include <unordered_map>
+
+void hlx::inferEffects(
+    llvm::ArrayRef<ResolvedFunctionDecl *> module,
+    llvm::ArrayRef<std::vector<const ResolvedFunctionDecl *>> callees,
+    llvm::ArrayRef<char> loops) {
+  std::unordered_map<const ResolvedFunctionDecl *, size_t> indices;
+  for (size_t i = 0; i < module.size(); ++i)
+    indices.emplace(module[i], i);
+
+  // Callers of each function, every one once, and the number of distinct
+  // callees not known to return yet.
+  std::vector<std::vector<size_t>> callers(module.size());
+  std::vector<size_t> pending(module.size());
+  std::vector<size_t> worklist;
+  for (size_t i = 0; i < module.size(); ++i) {
+    ResolvedFunctionDecl &fn = *module[i];
+    fn.isPure = fn.identifier != symbols::println;
+    fn.willReturn = false;
+
+    std::vector<size_t> called;
+    for (auto &&callee : callees[i]) {
+      auto found = indices.find(callee);
+      if (found != indices.end()) {
+        called.emplace_back(found->second);
+        continue;
+      }
+      fn.isPure = false;
+      ++pending[i];
+    }
+    std::sort(called.begin(), called.end());
+    called.erase(std::unique(called.begin(), called.end()), called.end());
+    for (auto &&callee : called)
+      callers[callee].emplace_back(i);
+    pending[i] += called.size();
+
+    if (!fn.isPure)
+      worklist.emplace_back(i);
+  }
+
+  // Printing propagates to every caller, also around cycles.
+  while (!worklist.empty()) {
+    size_t i = worklist.back();
+    worklist.pop_back();
+    for (auto &&caller : callers[i]) {
+      if (!module[caller]->isPure)
+        continue;
+      module[caller]->isPure = false;
+      worklist.emplace_back(caller);
+    }
+  }
+
+  // A function returns once all of its callees do, so the ones on a cycle
+  // never get there.
+  for (size_t i = 0; i < module.size(); ++i)
+    if (!pending[i] && !loops[i])
+      worklist.emplace_back(i);
+  while (!worklist.empty()) {
+    size_t i = worklist.back();
+    worklist.pop_back();
+    module[i]->willReturn = true;
+    for (auto &&caller : callers[i])
+      if (!--pending[caller] && !loops[caller])
+        worklist.emplace_back(caller);
+  }
+}
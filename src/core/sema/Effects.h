@@ -0,0 +1,15 @@
+#pragma once
+
+#include "../ast/ResolvedAst.h"
+#include <llvm/ADT/ArrayRef.h>
+#include <vector>
+
+namespace hlx {
+// Sets the effects of every function in 'module' from the call graph, bottom
+// up. callees[i] holds the functions module[i] calls and loops[i] whether
+// its body contains a loop. A callee outside of 'module' is assumed to do
+// anything.
+void inferEffects(llvm::ArrayRef<ResolvedFunctionDecl *> module,
+                  llvm::ArrayRef<std::vector<const ResolvedFunctionDecl *>> callees,
+                  llvm::ArrayRef<char> loops);
+} // namespace hlx
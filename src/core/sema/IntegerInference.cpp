@@ -0,0 +1,686 @@
+#include "IntegerInference.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <llvm/ADT/DenseMap.h>
+#include <vector>
+
+namespace hlx {
+namespace {
+// Integers of a larger magnitude are not all doubles.
+constexpr int64_t maxMagnitude = int64_t(1) << 53;
+
+// The integers a value may be, or any number if !isInteger. A range with
+// lo > hi is empty, the value of code no value reaches yet.
+struct Range {
+  int64_t lo = 1;
+  int64_t hi = 0;
+  bool isInteger = true;
+
+  static Range any() { return {0, 0, false}; }
+  static Range empty() { return {}; }
+  static Range of(int64_t lo, int64_t hi) {
+    if (lo > hi)
+      return empty();
+    if (lo < -maxMagnitude || hi > maxMagnitude)
+      return any();
+    return {lo, hi, true};
+  }
+  static Range boolean() { return {0, 1, true}; }
+
+  bool isEmpty() const { return isInteger && lo > hi; }
+  bool isBounded() const { return isInteger && lo <= hi; }
+  bool mayBeZero() const { return lo <= 0 && 0 <= hi; }
+
+  bool operator==(const Range &other) const {
+    if (isInteger != other.isInteger)
+      return false;
+    if (!isInteger || (isEmpty() && other.isEmpty()))
+      return true;
+    return lo == other.lo && hi == other.hi;
+  }
+};
+
+Range join(const Range &a, const Range &b) {
+  if (!a.isInteger || !b.isInteger)
+    return Range::any();
+  if (a.isEmpty())
+    return b;
+  if (b.isEmpty())
+    return a;
+  return {std::min(a.lo, b.lo), std::max(a.hi, b.hi), true};
+}
+
+Range rangeOf(double value) {
+  // -0 == 0, but it is not an integer here.
+  if (!(std::fabs(value) <= maxMagnitude) || std::trunc(value) != value ||
+      (value == 0 && std::signbit(value)))
+    return Range::any();
+  auto integer = static_cast<int64_t>(value);
+  return Range::of(integer, integer);
+}
+
+Range negate(const Range &operand) {
+  if (!operand.isBounded())
+    return operand;
+  if (operand.mayBeZero())
+    return Range::any();
+  return Range::of(-operand.hi, -operand.lo);
+}
+
+Range apply(TokenKind op, const Range &lhs, const Range &rhs) {
+  switch (op) {
+  case TokenKind::Lt:
+  case TokenKind::Gt:
+  case TokenKind::LessThanEql:
+  case TokenKind::MoreThanEql:
+  case TokenKind::EqualEqual:
+  case TokenKind::NotEqual:
+  case TokenKind::AmpAmp:
+  case TokenKind::PipePipe:
+    return Range::boolean();
+  default:
+    break;
+  }
+
+  if (!lhs.isInteger || !rhs.isInteger)
+    return Range::any();
+  if (lhs.isEmpty() || rhs.isEmpty())
+    return Range::empty();
+
+  switch (op) {
+  case TokenKind::Plus:
+    return Range::of(lhs.lo + rhs.lo, lhs.hi + rhs.hi);
+  case TokenKind::Minus:
+    return Range::of(lhs.lo - rhs.hi, lhs.hi - rhs.lo);
+  case TokenKind::Asterisk: {
+    // 0 times a negative number is -0.
+    if ((lhs.mayBeZero() && rhs.lo < 0) || (rhs.mayBeZero() && lhs.lo < 0))
+      return Range::any();
+    int64_t products[4];
+    if (__builtin_mul_overflow(lhs.lo, rhs.lo, &products[0]) ||
+        __builtin_mul_overflow(lhs.lo, rhs.hi, &products[1]) ||
+        __builtin_mul_overflow(lhs.hi, rhs.lo, &products[2]) ||
+        __builtin_mul_overflow(lhs.hi, rhs.hi, &products[3]))
+      return Range::any();
+    return Range::of(*std::min_element(products, products + 4),
+                     *std::max_element(products, products + 4));
+  }
+  case TokenKind::Mod: {
+    // The remainder has the sign of the dividend, a zero one is -0 for a
+    // negative dividend.
+    if (lhs.lo < 0 || rhs.mayBeZero())
+      return Range::any();
+    int64_t divisor = std::max(-rhs.lo, rhs.hi);
+    return Range::of(0, std::min(lhs.hi, divisor - 1));
+  }
+  default:
+    return Range::any();
+  }
+}
+
+bool isArithmetic(TokenKind op) {
+  return op == TokenKind::Plus || op == TokenKind::Minus ||
+         op == TokenKind::Asterisk || op == TokenKind::Mod;
+}
+
+const ResolvedExpr *stripGroupings(const ResolvedExpr *expr) {
+  while (const auto *grouping = llvm::dyn_cast<ResolvedGroupingExpr>(expr))
+    expr = grouping->expr;
+  return expr;
+}
+
+class IntegerInference {
+  // Nodes one function may visit, bounds the time spent on deeply nested
+  // loops. Past it nothing is an integer.
+  static constexpr size_t stepBudget = 1 << 22;
+  // Rounds a loop is iterated before its bounds are widened, and rounds
+  // to narrow them again once they are stable.
+  static constexpr unsigned widenAfter = 3;
+  static constexpr unsigned narrowRounds = 2;
+  // Conditions nested deeper are not used to narrow ranges.
+  static constexpr unsigned refineDepth = 32;
+
+  struct State {
+    bool reachable = true;
+    // By variable index.
+    std::vector<Range> vars;
+
+    bool operator==(const State &other) const {
+      return reachable == other.reachable &&
+             (!reachable || vars == other.vars);
+    }
+  };
+
+  llvm::DenseMap<const ResolvedDecl *, unsigned> varIndices;
+  std::vector<const ResolvedVarDecl *> vars;
+  // Joined over every value the variable is assigned.
+  std::vector<Range> assigned;
+  // Values of the arithmetic operators.
+  llvm::DenseMap<const ResolvedExpr *, Range> values;
+  // Only the last pass over the body, with the ranges of loops known,
+  // records assigned values and operator values.
+  bool recording = true;
+  size_t steps = 0;
+
+  struct Frame {
+    const ResolvedExpr *expr;
+    // Number of children visited so far.
+    size_t visited = 0;
+  };
+  // Stacks of evaluate(), kept to reuse their memory.
+  std::vector<Frame> frames;
+  std::vector<Range> results;
+
+  bool isExhausted() const { return steps > stepBudget; }
+  void collectVars(const ResolvedBlock &block);
+  static void join(State &state, const State &other);
+  static State widen(const State &head, const State &next);
+
+  Range lookup(const ResolvedDecl *decl, const State &state) const;
+  void assign(const ResolvedVarDecl *var, Range value, State &state);
+  Range evaluate(const ResolvedExpr &expr, const State &state);
+  void refine(State &state, const ResolvedExpr &condition, bool isTrue,
+              unsigned depth = 0);
+  void refineComparison(State &state, TokenKind op, const ResolvedExpr &lhs,
+                        const ResolvedExpr &rhs);
+  void analyze(const ResolvedBlock &block, State &state);
+  void analyzeWhile(const ResolvedWhileStmt &stmt, State &state);
+
+  void setTypes(const ResolvedBlock &block);
+  void setTypes(ResolvedExpr &expr);
+
+public:
+  void run(ResolvedFunctionDecl &function);
+};
+
+void IntegerInference::collectVars(const ResolvedBlock &block) {
+  for (auto &&stmt : block.statements) {
+    if (const auto *declStmt = llvm::dyn_cast<ResolvedDeclStmt>(stmt)) {
+      varIndices[declStmt->varDecl] = vars.size();
+      vars.emplace_back(declStmt->varDecl);
+    } else if (const auto *ifStmt = llvm::dyn_cast<ResolvedIfStmt>(stmt)) {
+      collectVars(*ifStmt->trueBlock);
+      if (ifStmt->falseBlock)
+        collectVars(*ifStmt->falseBlock);
+    } else if (const auto *whileStmt =
+                   llvm::dyn_cast<ResolvedWhileStmt>(stmt)) {
+      collectVars(*whileStmt->body);
+    }
+  }
+}
+
+void IntegerInference::join(State &state, const State &other) {
+  if (!other.reachable)
+    return;
+  if (!state.reachable) {
+    state = other;
+    return;
+  }
+  for (size_t i = 0; i < state.vars.size(); ++i)
+    state.vars[i] = hlx::join(state.vars[i], other.vars[i]);
+}
+
+// Bounds that are still moving jump to the largest magnitude, from where
+// they can only become any number, so loops reach a fixpoint quickly.
+IntegerInference::State IntegerInference::widen(const State &head,
+                                                const State &next) {
+  if (!head.reachable)
+    return next;
+
+  State widened = next;
+  for (size_t i = 0; i < head.vars.size(); ++i) {
+    const Range &before = head.vars[i];
+    Range &after = widened.vars[i];
+    if (!after.isBounded() || before.isEmpty())
+      continue;
+    if (after.lo < before.lo)
+      after.lo = -maxMagnitude;
+    if (after.hi > before.hi)
+      after.hi = maxMagnitude;
+  }
+  return widened;
+}
+
+Range IntegerInference::lookup(const ResolvedDecl *decl,
+                               const State &state) const {
+  auto found = varIndices.find(decl);
+  return found == varIndices.end() ? Range::any()
+                                   : state.vars[found->second];
+}
+
+void IntegerInference::assign(const ResolvedVarDecl *var, Range value,
+                              State &state) {
+  unsigned idx = varIndices.lookup(var);
+  state.vars[idx] = value;
+  if (recording)
+    assigned[idx] = hlx::join(assigned[idx], value);
+}
+
+// Walks the expression with an explicit stack like Sema::resolveExpr().
+Range IntegerInference::evaluate(const ResolvedExpr &expr,
+                                 const State &state) {
+  frames.assign(1, {&expr});
+  results.clear();
+
+  while (!frames.empty()) {
+    Frame &frame = frames.back();
+    const ResolvedExpr &current = *frame.expr;
+    Range range;
+
+    switch (current.getKind()) {
+    case ResolvedStmt::Kind::NumberLiteral:
+      range = rangeOf(llvm::cast<ResolvedNumberLiteral>(current).value);
+      break;
+    case ResolvedStmt::Kind::DeclRefExpr:
+      range = lookup(llvm::cast<ResolvedDeclRefExpr>(current).decl, state);
+      break;
+    case ResolvedStmt::Kind::CallExpr: {
+      const auto &call = llvm::cast<ResolvedCallExpr>(current);
+      if (frame.visited < call.arguments.size()) {
+        frames.push_back({call.arguments[frame.visited++]});
+        continue;
+      }
+      results.resize(results.size() - call.arguments.size());
+      range = Range::any();
+      break;
+    }
+    case ResolvedStmt::Kind::GroupingExpr:
+      if (frame.visited++ == 0) {
+        frames.push_back({llvm::cast<ResolvedGroupingExpr>(current).expr});
+        continue;
+      }
+      range = results.back();
+      results.pop_back();
+      break;
+    case ResolvedStmt::Kind::UnaryOperator: {
+      const auto &unary = llvm::cast<ResolvedUnaryOperator>(current);
+      if (frame.visited++ == 0) {
+        frames.push_back({unary.operand});
+        continue;
+      }
+      range = unary.op == TokenKind::Minus ? negate(results.back())
+                                           : Range::boolean();
+      results.pop_back();
+      if (recording && unary.op == TokenKind::Minus)
+        values[&current] = hlx::join(values.lookup(&current), range);
+      break;
+    }
+    case ResolvedStmt::Kind::BinaryOperator: {
+      const auto &binop = llvm::cast<ResolvedBinaryOperator>(current);
+      if (frame.visited < 2) {
+        frames.push_back({frame.visited++ == 0 ? binop.lhs : binop.rhs});
+        continue;
+      }
+      Range rhs = results.back();
+      results.pop_back();
+      range = apply(binop.op, results.back(), rhs);
+      results.pop_back();
+      if (recording && isArithmetic(binop.op))
+        values[&current] = hlx::join(values.lookup(&current), range);
+      break;
+    }
+    default:
+      llvm_unreachable("unexpected expression");
+    }
+
+    ++steps;
+    results.emplace_back(range);
+    frames.pop_back();
+  }
+
+  return results.back();
+}
+
+// Narrows the ranges in 'state' to the values for which 'condition' is
+// 'isTrue', marking it unreachable if there are none.
+void IntegerInference::refine(State &state, const ResolvedExpr &condition,
+                              bool isTrue, unsigned depth) {
+  if (!state.reachable || depth > refineDepth)
+    return;
+
+  const ResolvedExpr *expr = stripGroupings(&condition);
+  if (const auto *unary = llvm::dyn_cast<ResolvedUnaryOperator>(expr)) {
+    if (unary->op == TokenKind::Excl)
+      refine(state, *unary->operand, !isTrue, depth + 1);
+    return;
+  }
+
+  const auto *binop = llvm::dyn_cast<ResolvedBinaryOperator>(expr);
+  if (!binop)
+    return;
+
+  // Both operands of a true '&&' are true, both of a false '||' false.
+  if ((binop->op == TokenKind::AmpAmp && isTrue) ||
+      (binop->op == TokenKind::PipePipe && !isTrue)) {
+    refine(state, *binop->lhs, isTrue, depth + 1);
+    refine(state, *binop->rhs, isTrue, depth + 1);
+    return;
+  }
+
+  TokenKind op = binop->op;
+  // Integers are never NaN, so a false comparison is the opposite one.
+  if (!isTrue) {
+    switch (op) {
+    case TokenKind::Lt:
+      op = TokenKind::MoreThanEql;
+      break;
+    case TokenKind::Gt:
+      op = TokenKind::LessThanEql;
+      break;
+    case TokenKind::LessThanEql:
+      op = TokenKind::Gt;
+      break;
+    case TokenKind::MoreThanEql:
+      op = TokenKind::Lt;
+      break;
+    case TokenKind::EqualEqual:
+      op = TokenKind::NotEqual;
+      break;
+    case TokenKind::NotEqual:
+      op = TokenKind::EqualEqual;
+      break;
+    default:
+      return;
+    }
+  }
+
+  TokenKind mirrored;
+  switch (op) {
+  case TokenKind::Lt:
+    mirrored = TokenKind::Gt;
+    break;
+  case TokenKind::Gt:
+    mirrored = TokenKind::Lt;
+    break;
+  case TokenKind::LessThanEql:
+    mirrored = TokenKind::MoreThanEql;
+    break;
+  case TokenKind::MoreThanEql:
+    mirrored = TokenKind::LessThanEql;
+    break;
+  case TokenKind::EqualEqual:
+  case TokenKind::NotEqual:
+    mirrored = op;
+    break;
+  default:
+    return;
+  }
+
+  refineComparison(state, op, *binop->lhs, *binop->rhs);
+  refineComparison(state, mirrored, *binop->rhs, *binop->lhs);
+}
+
+// Narrows the variable 'lhs' refers to, if any, to the values for which
+// 'lhs op rhs' holds.
+void IntegerInference::refineComparison(State &state, TokenKind op,
+                                        const ResolvedExpr &lhs,
+                                        const ResolvedExpr &rhs) {
+  if (!state.reachable)
+    return;
+
+  const auto *ref = llvm::dyn_cast<ResolvedDeclRefExpr>(stripGroupings(&lhs));
+  auto found = ref ? varIndices.find(ref->decl) : varIndices.end();
+  if (found == varIndices.end())
+    return;
+  Range &var = state.vars[found->second];
+  if (!var.isBounded())
+    return;
+
+  // Bounds of the other side. A literal need not be an integer, NaN never
+  // compares true, so it narrows nothing useful.
+  double lo, hi;
+  const ResolvedExpr *other = stripGroupings(&rhs);
+  if (const auto *literal = llvm::dyn_cast<ResolvedNumberLiteral>(other)) {
+    if (std::isnan(literal->value))
+      return;
+    lo = hi = literal->value;
+  } else {
+    Range range = evaluate(*other, state);
+    if (!range.isBounded())
+      return;
+    lo = range.lo;
+    hi = range.hi;
+  }
+
+  // Clamped, so every bound converts and the narrowed range stays valid.
+  auto clamp = [](double bound) {
+    double limit = static_cast<double>(maxMagnitude) + 1;
+    return static_cast<int64_t>(std::max(-limit, std::min(limit, bound)));
+  };
+
+  int64_t newLo = var.lo;
+  int64_t newHi = var.hi;
+  switch (op) {
+  case TokenKind::Lt:
+    newHi = std::min(newHi, clamp(std::ceil(hi) - 1));
+    break;
+  case TokenKind::LessThanEql:
+    newHi = std::min(newHi, clamp(std::floor(hi)));
+    break;
+  case TokenKind::Gt:
+    newLo = std::max(newLo, clamp(std::floor(lo) + 1));
+    break;
+  case TokenKind::MoreThanEql:
+    newLo = std::max(newLo, clamp(std::ceil(lo)));
+    break;
+  case TokenKind::EqualEqual:
+    newLo = std::max(newLo, clamp(std::ceil(lo)));
+    newHi = std::min(newHi, clamp(std::floor(hi)));
+    break;
+  case TokenKind::NotEqual:
+    if (lo != hi || std::trunc(lo) != lo)
+      return;
+    if (newLo == lo)
+      ++newLo;
+    else if (newHi == hi)
+      --newHi;
+    break;
+  default:
+    return;
+  }
+
+  var = newLo > newHi ? Range::empty() : Range{newLo, newHi, true};
+  if (var.isEmpty())
+    state.reachable = false;
+}
+
+void IntegerInference::analyze(const ResolvedBlock &block, State &state) {
+  for (auto &&stmt : block.statements) {
+    if (!state.reachable || isExhausted())
+      return;
+    ++steps;
+
+    switch (stmt->getKind()) {
+    case ResolvedStmt::Kind::DeclStmt: {
+      const ResolvedVarDecl *var = llvm::cast<ResolvedDeclStmt>(stmt)->varDecl;
+      // A variable read before it is assigned holds anything.
+      if (var->initializer)
+        assign(var, evaluate(*var->initializer, state), state);
+      else
+        state.vars[varIndices.lookup(var)] = Range::any();
+      break;
+    }
+    case ResolvedStmt::Kind::Assignment: {
+      const auto *assignment = llvm::cast<ResolvedAssignment>(stmt);
+      Range value = evaluate(*assignment->expr, state);
+      if (const auto *var =
+              llvm::dyn_cast<ResolvedVarDecl>(assignment->variable->decl))
+        assign(var, value, state);
+      break;
+    }
+    case ResolvedStmt::Kind::IfStmt: {
+      const auto *ifStmt = llvm::cast<ResolvedIfStmt>(stmt);
+      evaluate(*ifStmt->condition, state);
+
+      State falseState = state;
+      refine(state, *ifStmt->condition, true);
+      refine(falseState, *ifStmt->condition, false);
+      analyze(*ifStmt->trueBlock, state);
+      if (ifStmt->falseBlock)
+        analyze(*ifStmt->falseBlock, falseState);
+      join(state, falseState);
+      break;
+    }
+    case ResolvedStmt::Kind::WhileStmt:
+      analyzeWhile(llvm::cast<ResolvedWhileStmt>(*stmt), state);
+      break;
+    case ResolvedStmt::Kind::ReturnStmt: {
+      const auto *returnStmt = llvm::cast<ResolvedReturnStmt>(stmt);
+      if (returnStmt->expr)
+        evaluate(*returnStmt->expr, state);
+      state.reachable = false;
+      break;
+    }
+    default:
+      evaluate(*llvm::cast<ResolvedExpr>(stmt), state);
+      break;
+    }
+  }
+}
+
+// Iterates the body from the state at the loop until the state at its
+// condition stops changing, then records the body once with that state.
+void IntegerInference::analyzeWhile(const ResolvedWhileStmt &stmt,
+                                    State &state) {
+  const State entry = state;
+  State head = state;
+  bool wasRecording = recording;
+  recording = false;
+
+  auto iterate = [&](const State &head) {
+    State body = head;
+    refine(body, *stmt.condition, true);
+    analyze(*stmt.body, body);
+    State next = entry;
+    join(next, body);
+    return next;
+  };
+
+  for (unsigned round = 0; !isExhausted(); ++round) {
+    State next = iterate(head);
+    // Nothing new reached the condition.
+    State joined = head;
+    join(joined, next);
+    if (joined == head)
+      break;
+    head = round < widenAfter ? joined : widen(head, joined);
+  }
+  for (unsigned round = 0; round < narrowRounds && !isExhausted(); ++round) {
+    State next = iterate(head);
+    if (next == head)
+      break;
+    head = next;
+  }
+
+  recording = wasRecording;
+  if (recording) {
+    evaluate(*stmt.condition, head);
+    State body = head;
+    refine(body, *stmt.condition, true);
+    analyze(*stmt.body, body);
+  }
+
+  state = head;
+  refine(state, *stmt.condition, false);
+}
+
+void IntegerInference::setTypes(const ResolvedBlock &block) {
+  for (auto &&stmt : block.statements) {
+    switch (stmt->getKind()) {
+    case ResolvedStmt::Kind::DeclStmt: {
+      ResolvedVarDecl *var = llvm::cast<ResolvedDeclStmt>(stmt)->varDecl;
+      const Range &range = assigned[varIndices.lookup(var)];
+      var->type = range.isBounded() && !isExhausted()
+                      ? TypeContext::get().getInteger()
+                      : TypeContext::get().getNumber();
+      if (var->initializer)
+        setTypes(*var->initializer);
+      break;
+    }
+    case ResolvedStmt::Kind::Assignment: {
+      auto *assignment = llvm::cast<ResolvedAssignment>(stmt);
+      setTypes(*assignment->variable);
+      setTypes(*assignment->expr);
+      break;
+    }
+    case ResolvedStmt::Kind::IfStmt: {
+      const auto *ifStmt = llvm::cast<ResolvedIfStmt>(stmt);
+      setTypes(*ifStmt->condition);
+      setTypes(*ifStmt->trueBlock);
+      if (ifStmt->falseBlock)
+        setTypes(*ifStmt->falseBlock);
+      break;
+    }
+    case ResolvedStmt::Kind::WhileStmt: {
+      const auto *whileStmt = llvm::cast<ResolvedWhileStmt>(stmt);
+      setTypes(*whileStmt->condition);
+      setTypes(*whileStmt->body);
+      break;
+    }
+    case ResolvedStmt::Kind::ReturnStmt:
+      if (ResolvedExpr *expr = llvm::cast<ResolvedReturnStmt>(stmt)->expr)
+        setTypes(*expr);
+      break;
+    default:
+      setTypes(*llvm::cast<ResolvedExpr>(stmt));
+      break;
+    }
+  }
+}
+
+// Children are typed before their parents, a grouping has the type of
+// what it groups. Declarations are typed before their uses.
+void IntegerInference::setTypes(ResolvedExpr &expr) {
+  std::vector<ResolvedExpr *> order{&expr};
+  for (size_t i = 0; i < order.size(); ++i) {
+    ResolvedExpr *current = order[i];
+    if (auto *call = llvm::dyn_cast<ResolvedCallExpr>(current))
+      order.insert(order.end(), call->arguments.begin(), call->arguments.end());
+    else if (auto *grouping = llvm::dyn_cast<ResolvedGroupingExpr>(current))
+      order.emplace_back(grouping->expr);
+    else if (auto *unary = llvm::dyn_cast<ResolvedUnaryOperator>(current))
+      order.emplace_back(unary->operand);
+    else if (auto *binop = llvm::dyn_cast<ResolvedBinaryOperator>(current)) {
+      order.emplace_back(binop->lhs);
+      order.emplace_back(binop->rhs);
+    }
+  }
+
+  const TypeContext &types = TypeContext::get();
+  auto integerIf = [&](const ResolvedExpr *expr) {
+    auto found = values.find(expr);
+    bool isInteger = found != values.end() && found->second.isBounded() &&
+                     !isExhausted();
+    return isInteger ? types.getInteger() : types.getNumber();
+  };
+
+  for (auto it = order.rbegin(); it != order.rend(); ++it) {
+    ResolvedExpr *current = *it;
+    if (auto *ref = llvm::dyn_cast<ResolvedDeclRefExpr>(current))
+      ref->type = ref->decl->type;
+    else if (auto *grouping = llvm::dyn_cast<ResolvedGroupingExpr>(current))
+      grouping->type = grouping->expr->type;
+    else if (auto *unary = llvm::dyn_cast<ResolvedUnaryOperator>(current))
+      unary->type = integerIf(unary);
+    else if (auto *binop = llvm::dyn_cast<ResolvedBinaryOperator>(current))
+      binop->type = integerIf(binop);
+  }
+}
+
+void IntegerInference::run(ResolvedFunctionDecl &function) {
+  collectVars(*function.body);
+  assigned.assign(vars.size(), Range::empty());
+
+  State state;
+  state.vars.assign(vars.size(), Range::empty());
+  analyze(*function.body, state);
+  setTypes(*function.body);
+}
+} // namespace
+
+void inferIntegers(ResolvedFunctionDecl &function) {
+  IntegerInference().run(function);
+}
+} // namespace hlx
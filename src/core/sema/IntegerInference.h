@@ -0,0 +1,23 @@
+#pragma once
+
+#include "../ast/ResolvedAst.h"
+
+namespace hlx {
+// Proves which variables of 'function' only ever hold integers that double
+// arithmetic computes exactly, those in [-2^53, 2^53], and gives them the
+// Integer type. So do the '+', '-', '*', '%' and negations whose value is
+// always such an integer, along with the references to the variables and
+// the groupings around them. Codegen keeps Integer values in i64 and only
+// converts them where they escape into something that takes a double.
+//
+// Values come from integer literals, comparisons and logical operators,
+// and arithmetic on integers. The body is interpreted over intervals that
+// the conditions of ifs and loops narrow, so 'i = i + 1' in a loop on
+// 'i < 10' stays bounded. -0 prints differently from 0 and is never an
+// integer: operators that could produce it, like '-i' for an 'i' that may
+// be 0, are not either.
+//
+// Every type the analysis sets is recomputed when it runs again, e.g. after
+// CTFE rewrote the body.
+void inferIntegers(ResolvedFunctionDecl &function);
+} // namespace hlx
@@ -1,9 +1,16 @@
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstddef>
+#include <llvm/ADT/APFloat.h>
 #include <memory>
+#include <unordered_map>
 #include <utility>
 
+#include "../../utils/Parallel.h"
 #include "../../utils/Utils.h"
+#include "Effects.h"
+#include "IntegerInference.h"
 #include "Sema.h"
 
 
@@ -12,72 +19,95 @@ bool Sema::insertDeclToCurrentScope(ResolvedDecl &decl) {
   const auto &[foundDecl, scopeIdx] = lookupDecl(decl.identifier);
 
   if (foundDecl && scopeIdx == 0) {
-    report(decl.location, "redeclaration of '" + decl.identifier + '\'');
+    report(decl.location, "redeclaration of '" + std::string(decl.identifier.str()) + '\'');
     return false;
   }
 
-  scopes.back().emplace_back(&decl);
+  uint32_t symbol = decl.identifier.getId();
+  if (symbol >= innermost.size())
+    innermost.resize(symbol + 1, -1);
+
+  int32_t &binding = innermost[symbol];
+  bindings.push_back({&decl, symbol,
+                      static_cast<uint32_t>(scopeStarts.size() - 1), binding});
+  binding = bindings.size() - 1;
   return true;
 }
 
-std::pair<ResolvedDecl *, int> Sema::lookupDecl(const std::string id) {
-  int scopeIdx = 0;
-  for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
-    for (auto &&decl : *it) {
-      if (decl->identifier != id)
-        continue;
+void Sema::removeGlobalDecl(const ResolvedDecl &decl) {
+  assert(scopeStarts.size() == 1 && "only the global scope may be open");
+  // Global bindings shadow nothing, so the last one can fill the gap.
+  int32_t idx = innermost[decl.identifier.getId()];
+  assert(bindings[idx].decl == &decl && "not a global decl");
+  innermost[decl.identifier.getId()] = -1;
+  if (static_cast<size_t>(idx) + 1 != bindings.size()) {
+    bindings[idx] = bindings.back();
+    innermost[bindings[idx].symbol] = idx;
+  }
+  bindings.pop_back();
+}
 
-      return {decl, scopeIdx};
-    }
+void Sema::exitScope() {
+  size_t start = scopeStarts.back();
+  scopeStarts.pop_back();
+  while (bindings.size() > start) {
+    innermost[bindings.back().symbol] = bindings.back().shadowed;
+    bindings.pop_back();
+  }
+}
 
-    ++scopeIdx;
+std::pair<ResolvedDecl *, int> Sema::lookupDecl(Symbol id) const {
+  if (id.getId() >= innermost.size() || innermost[id.getId()] < 0) {
+    if (!enclosing)
+      return {nullptr, -1};
+
+    const auto &[decl, scopeIdx] = enclosing->lookupDecl(id);
+    return {decl, decl ? scopeIdx + static_cast<int>(scopeStarts.size()) : -1};
   }
 
-  return {nullptr, -1};
+  const Binding &binding = bindings[innermost[id.getId()]];
+  return {binding.decl,
+          static_cast<int>(scopeStarts.size() - 1 - binding.depth)};
 }
 
-std::unique_ptr<ResolvedFunctionDecl> Sema::createBuiltinPrintln() {
-  SourceLocation loc = SourceLocation{"<builtin>", 0, 0};
+ResolvedFunctionDecl *Sema::createBuiltinPrintln() {
+  SourceLocation loc = SourceLocation{};
 
   auto param =
-      std::make_unique<ResolvedParamDecl>(loc, "n", Type::builtinNumber());
-
-  std::vector<std::unique_ptr<ResolvedParamDecl>> params;
-  params.emplace_back(std::move(param));
+      arena->make<ResolvedParamDecl>(loc, symbols::n, types.getNumber());
+  auto block = arena->make<ResolvedBlock>(loc, llvm::ArrayRef<ResolvedStmt *>());
 
-  auto block = std::make_unique<ResolvedBlock>(
-      loc, std::vector<std::unique_ptr<ResolvedStmt>>());
-
-  return std::make_unique<ResolvedFunctionDecl>(
-      loc, "println", Type::builtinVoid(), std::move(params), std::move(block));
+  return arena->make<ResolvedFunctionDecl>(
+      loc, symbols::println, types.getVoid(),
+      arena->copyArray(std::vector<ResolvedParamDecl *>{param}), block);
 };
 
-std::optional<Type> Sema::resolveType(Type parsedType) {
+const Type *Sema::resolveType(const Type &parsedType) {
   if (parsedType.kind == Type::Kind::Custom)
-    return std::nullopt;
+    return nullptr;
 
-  return parsedType;
+  return types.get(parsedType);
 }
 
-std::unique_ptr<ResolvedDeclRefExpr>
+ResolvedDeclRefExpr *
 Sema::resolveDeclRefExpr(const DeclRefExpr &declRefExpr, bool inCall) {
   ResolvedDecl *decl = lookupDecl(declRefExpr.identifier).first;
   if (!decl)
     return report(declRefExpr.location,
-                  "symbol '" + declRefExpr.identifier + "' not found");
+                  "symbol '" + std::string(declRefExpr.identifier.str()) + "' not found");
 
-  if (!inCall && dynamic_cast<ResolvedFunctionDecl *>(decl))
+  if (!inCall && llvm::isa<ResolvedFunctionDecl>(decl))
     return report(declRefExpr.location,
-                  "expected to call function '" + declRefExpr.identifier + "'");
+                  "expected to call function '" + std::string(declRefExpr.identifier.str()) + "'");
 
-  return std::make_unique<ResolvedDeclRefExpr>(declRefExpr.location, *decl);
+  return arena->make<ResolvedDeclRefExpr>(declRefExpr.location, *decl);
 }
 
-std::unique_ptr<ResolvedCallExpr> Sema::resolveCallExpr(const CallExpr &call) {
+const ResolvedFunctionDecl *Sema::resolveCallee(const CallExpr &call) {
   varOrReturn(resolvedCallee, resolveDeclRefExpr(*call.identifier, true));
 
   const auto *resolvedFunctionDecl =
-      dynamic_cast<const ResolvedFunctionDecl *>(resolvedCallee->decl);
+      llvm::dyn_cast<ResolvedFunctionDecl>(resolvedCallee->decl);
 
   if (!resolvedFunctionDecl)
     return report(call.location, "calling non-function symbol");
@@ -85,188 +115,388 @@ std::unique_ptr<ResolvedCallExpr> Sema::resolveCallExpr(const CallExpr &call) {
   if (call.arguments.size() != resolvedFunctionDecl->params.size())
     return report(call.location, "argument count missmatch in function call");
 
-  std::vector<std::unique_ptr<ResolvedExpr>> resolvedArguments;
-  int idx = 0;
-  for (auto &&arg : call.arguments) {
-    varOrReturn(resolvedArg, resolveExpr(*arg));
-
-    if (resolvedArg->type.kind != resolvedFunctionDecl->params[idx]->type.kind)
-      return report(resolvedArg->location, "unexpected type of argument");
-
-    ++idx;
-    resolvedArguments.emplace_back(std::move(resolvedArg));
-  }
-
-  return std::make_unique<ResolvedCallExpr>(
-      call.location, *resolvedFunctionDecl, std::move(resolvedArguments));
+  calledFunctions.emplace_back(resolvedFunctionDecl);
+  return resolvedFunctionDecl;
 }
 
-std::unique_ptr<ResolvedIfStmt> Sema::resolveIfStmt(const IfStmt &ifStmt){
+ResolvedIfStmt *Sema::resolveIfStmt(const IfStmt &ifStmt){
     varOrReturn(condition, resolveExpr(*ifStmt.condition));
 
-    if(condition->type.kind!=Type::Kind::Number)
+    if(condition->type->kind!=Type::Kind::Number)
       return report(condition->location, "expected number in condition");
 
     varOrReturn(resolvedTrueBlock, resolveBlock(*ifStmt.trueBlock));
 
-    std::unique_ptr<ResolvedBlock> resolvedFalseBlock;
+    ResolvedBlock *resolvedFalseBlock = nullptr;
     if(ifStmt.falseBlock){
       resolvedFalseBlock=resolveBlock(*ifStmt.falseBlock);
       if(!resolvedFalseBlock)
         return nullptr;
     }
 
-    return std::make_unique<ResolvedIfStmt>(ifStmt.location,std::move(condition),std::move(resolvedTrueBlock),std::move(resolvedFalseBlock ));
+    return arena->make<ResolvedIfStmt>(ifStmt.location,condition,resolvedTrueBlock,resolvedFalseBlock);
     
 }
 
-std::unique_ptr<ResolvedAssignment> Sema::resolveAssignment(const Assignment &assignment) {
+ResolvedAssignment *Sema::resolveAssignment(const Assignment &assignment) {
   varOrReturn(resolvedLHS, resolveDeclRefExpr(*assignment.variable));
   varOrReturn(resolvedRHS, resolveExpr(*assignment.expr));
 
-  if (dynamic_cast<const ResolvedParamDecl *>(resolvedLHS->decl))
+  if (llvm::isa<ResolvedParamDecl>(resolvedLHS->decl))
     return report(resolvedLHS->location,
                   "parameters are immutable and cannot be assigned");
 
-  auto *var = dynamic_cast<const ResolvedVarDecl *>(resolvedLHS->decl);
+  auto *var = llvm::dyn_cast<ResolvedVarDecl>(resolvedLHS->decl);
   
-    if (resolvedRHS->type.kind != resolvedLHS->type.kind)
+    if (resolvedRHS->type != resolvedLHS->type)
       return report(resolvedRHS->location,
                     "assigned value type doesn't match variable type");
   
-  return std::make_unique<ResolvedAssignment>(
-        assignment.location, std::move(resolvedLHS), std::move(resolvedRHS));
+  return arena->make<ResolvedAssignment>(
+        assignment.location, resolvedLHS, resolvedRHS);
 }
 
-std::unique_ptr<ResolvedWhileStmt> Sema::resolveWhileStmt(const WhileStmt &whileStmt){
+ResolvedWhileStmt *Sema::resolveWhileStmt(const WhileStmt &whileStmt){
   
   varOrReturn(condition, resolveExpr(*whileStmt.condition));
-  if(condition->type.kind!=Type::Kind::Number){
+  if(condition->type->kind!=Type::Kind::Number){
     return report(condition->location, "expected number in condition");
   }
 
   varOrReturn(body, resolveBlock(*whileStmt.body));
+  loopInBody = true;
 
-  return std::make_unique<ResolvedWhileStmt>(whileStmt.location,std::move(condition),std::move(body));
+  return arena->make<ResolvedWhileStmt>(whileStmt.location,condition,body);
 }
 
-std::unique_ptr<ResolvedStmt> Sema::resolveStmt(const Stmt &stmt) {
-  if (auto *expr = dynamic_cast<const Expr *>(&stmt))
-    return resolveExpr(*expr);
-
-  if(auto *ifStmt=dynamic_cast<const IfStmt *>(&stmt)){
-    return resolveIfStmt(*ifStmt);
-  }
-  if(auto *whileStmt=dynamic_cast<const WhileStmt *>(&stmt)){
-    return resolveWhileStmt(*whileStmt);
-  }
-  
-  if (auto *declStmt = dynamic_cast<const DeclStmt *>(&stmt)){
-     return resolveDeclStmt(*declStmt);
-  }
-
-  if(auto *assignment =dynamic_cast<const Assignment *>(&stmt)){
-    return resolveAssignment(*assignment);
+ResolvedStmt *Sema::resolveStmt(const Stmt &stmt) {
+  switch (stmt.getKind()) {
+  case Stmt::Kind::IfStmt:
+    return resolveIfStmt(llvm::cast<IfStmt>(stmt));
+  case Stmt::Kind::WhileStmt:
+    return resolveWhileStmt(llvm::cast<WhileStmt>(stmt));
+  case Stmt::Kind::DeclStmt:
+    return resolveDeclStmt(llvm::cast<DeclStmt>(stmt));
+  case Stmt::Kind::Assignment:
+    return resolveAssignment(llvm::cast<Assignment>(stmt));
+  case Stmt::Kind::ReturnStmt:
+    return resolveReturnStmt(llvm::cast<ReturnStmt>(stmt));
+  default:
+    return resolveExpr(llvm::cast<Expr>(stmt));
   }
-   
-
-  auto *returnStmt = dynamic_cast<const ReturnStmt *>(&stmt);
-  assert(returnStmt && "unknown statement");
-
-  return resolveReturnStmt(*returnStmt);
 }
 
-std::unique_ptr<ResolvedReturnStmt>
+ResolvedReturnStmt *
 Sema::resolveReturnStmt(const ReturnStmt &returnStmt) {
   assert(currentFunction && "return stmt outside a function");
 
-  if (currentFunction->type.kind == Type::Kind::Void && returnStmt.expr)
+  if (currentFunction->type->kind == Type::Kind::Void && returnStmt.expr)
     return report(returnStmt.location,
                   "unexpected return value in void function");
 
-  if (currentFunction->type.kind != Type::Kind::Void && !returnStmt.expr)
+  if (currentFunction->type->kind != Type::Kind::Void && !returnStmt.expr)
     return report(returnStmt.location, "expected a return value");
 
-  std::unique_ptr<ResolvedExpr> resolvedExpr;
+  ResolvedExpr *resolvedExpr = nullptr;
   if (returnStmt.expr) {
     resolvedExpr = resolveExpr(*returnStmt.expr);
     if (!resolvedExpr)
       return nullptr;
 
-    if (currentFunction->type.kind != resolvedExpr->type.kind)
+    if (currentFunction->type != resolvedExpr->type)
       return report(resolvedExpr->location, "unexpected return type");
   }
 
-  return std::make_unique<ResolvedReturnStmt>(returnStmt.location,
-                                              std::move(resolvedExpr));
+  return arena->make<ResolvedReturnStmt>(returnStmt.location,
+                                              resolvedExpr);
 }
 
-std::unique_ptr<ResolvedBinaryOperator>
-Sema::resolveBinaryOperator(const BinaryOperator &binop) {
-  varOrReturn(resolvedLHS, resolveExpr(*binop.lhs));
-  varOrReturn(resolvedRHS, resolveExpr(*binop.rhs));
+namespace {
+// Truth value of a number the way Codegen::doubleToBool() computes it, an
+// ordered comparison with zero, so NaN is false.
+bool toBool(double value) { return value < 0 || value > 0; }
+
+// Whether 'expr' is a literal of exactly 'value', -0 and +0 differ.
+bool isLiteral(const ResolvedExpr *expr, double value) {
+  const auto *literal = llvm::dyn_cast<ResolvedNumberLiteral>(expr);
+  return literal && literal->value == value &&
+         std::signbit(literal->value) == std::signbit(value);
+}
+} // namespace
+
+ResolvedNumberLiteral *Sema::makeConstant(SourceLocation location,
+                                          double value) {
+  if (enclosing) {
+    auto *literal = arena->make<ResolvedNumberLiteral>(location, 0, value);
+    unpooledLiterals.emplace_back(literal);
+    return literal;
+  }
+
+  return arena->make<ResolvedNumberLiteral>(
+      location, ConstantPool::get().intern(value), value);
+}
 
-  if (resolvedLHS->type.kind == Type::Kind::Void)
+// Evaluates exactly what Codegen would emit. The arithmetic is done with
+// APFloat like LLVM's own constant folder, which also decides the NaN a
+// constant 0/0 produces, '%' is frem, and comparisons are ordered, so they
+// are false when an operand is NaN. Only identities that hold for every
+// double are applied, x+0 is not one of them since -0+0 is +0.
+ResolvedExpr *Sema::foldBinaryOperator(const BinaryOperator &binop,
+                                       ResolvedExpr *lhs, ResolvedExpr *rhs) {
+  const auto *lhsLiteral = llvm::dyn_cast<ResolvedNumberLiteral>(lhs);
+  const auto *rhsLiteral = llvm::dyn_cast<ResolvedNumberLiteral>(rhs);
+  TokenKind op = binop.op;
+
+  // A short-circuiting LHS decides the result, the RHS is never evaluated.
+  if (lhsLiteral && op == TokenKind::AmpAmp && !toBool(lhsLiteral->value))
+    return makeConstant(binop.location, 0.0);
+  if (lhsLiteral && op == TokenKind::PipePipe && toBool(lhsLiteral->value))
+    return makeConstant(binop.location, 1.0);
+
+  if (lhsLiteral && rhsLiteral) {
+    double l = lhsLiteral->value;
+    double r = rhsLiteral->value;
+    llvm::APFloat result(l);
+    double value;
+    switch (op) {
+    case TokenKind::Plus:
+      result.add(llvm::APFloat(r), llvm::APFloat::rmNearestTiesToEven);
+      value = result.convertToDouble();
+      break;
+    case TokenKind::Minus:
+      result.subtract(llvm::APFloat(r), llvm::APFloat::rmNearestTiesToEven);
+      value = result.convertToDouble();
+      break;
+    case TokenKind::Asterisk:
+      result.multiply(llvm::APFloat(r), llvm::APFloat::rmNearestTiesToEven);
+      value = result.convertToDouble();
+      break;
+    case TokenKind::Slash:
+      result.divide(llvm::APFloat(r), llvm::APFloat::rmNearestTiesToEven);
+      value = result.convertToDouble();
+      break;
+    case TokenKind::Mod:
+      result.mod(llvm::APFloat(r));
+      value = result.convertToDouble();
+      break;
+    case TokenKind::Lt:
+      value = l < r;
+      break;
+    case TokenKind::Gt:
+      value = l > r;
+      break;
+    case TokenKind::LessThanEql:
+      value = l <= r;
+      break;
+    case TokenKind::MoreThanEql:
+      value = l >= r;
+      break;
+    case TokenKind::EqualEqual:
+      value = l == r;
+      break;
+    case TokenKind::NotEqual:
+      value = l < r || l > r;
+      break;
+    case TokenKind::AmpAmp:
+      value = toBool(l) && toBool(r);
+      break;
+    case TokenKind::PipePipe:
+      value = toBool(l) || toBool(r);
+      break;
+    default:
+      return nullptr;
+    }
+    return makeConstant(binop.location, value);
+  }
+
+  // The operand that is kept takes over the location of the operator, so
+  // diagnostics about the expression still point at the same place.
+  ResolvedExpr *kept = nullptr;
+  if (op == TokenKind::Asterisk && isLiteral(rhs, 1.0))
+    kept = lhs;
+  else if (op == TokenKind::Asterisk && isLiteral(lhs, 1.0))
+    kept = rhs;
+  else if (op == TokenKind::Slash && isLiteral(rhs, 1.0))
+    kept = lhs;
+  else if (op == TokenKind::Minus && isLiteral(rhs, 0.0))
+    kept = lhs;
+  else if (op == TokenKind::Plus && isLiteral(rhs, -0.0))
+    kept = lhs;
+  else if (op == TokenKind::Plus && isLiteral(lhs, -0.0))
+    kept = rhs;
+
+  if (kept)
+    kept->location = binop.location;
+  return kept;
+}
+
+ResolvedExpr *Sema::foldUnaryOperator(const UnaryOperator &unary,
+                                      ResolvedExpr *operand) {
+  const auto *literal = llvm::dyn_cast<ResolvedNumberLiteral>(operand);
+  if (!literal)
+    return nullptr;
+
+  if (unary.op == TokenKind::Minus)
+    return makeConstant(unary.location, -literal->value);
+  if (unary.op == TokenKind::Excl)
+    return makeConstant(unary.location, !toBool(literal->value));
+  return nullptr;
+}
+
+ResolvedExpr *Sema::resolveBinaryOperator(const BinaryOperator &binop,
+                                          ResolvedExpr *resolvedLHS,
+                                          ResolvedExpr *resolvedRHS) {
+  if (resolvedLHS->type->kind == Type::Kind::Void)
     return report(
         resolvedLHS->location,
         "void expression cannot be used as LHS operand to binary operator");
-  if (resolvedRHS->type.kind == Type::Kind::Void)
+  if (resolvedRHS->type->kind == Type::Kind::Void)
     return report(
         resolvedRHS->location,
         "void expression cannot be used as RHS operand to binary operator");
 
-  return std::make_unique<ResolvedBinaryOperator>(
-      binop.location, binop.op, std::move(resolvedLHS), std::move(resolvedRHS));
+  if (ResolvedExpr *folded =
+          foldBinaryOperator(binop, resolvedLHS, resolvedRHS))
+    return folded;
+  return arena->make<ResolvedBinaryOperator>(
+      binop.location, binop.op, resolvedLHS, resolvedRHS);
 }
 
-std::unique_ptr<ResolvedUnaryOperator>
-Sema::resolveUnaryOperator(const UnaryOperator &unary) {
-  varOrReturn(resolvedRHS, resolveExpr(*unary.operand));
-
-  if (resolvedRHS->type.kind == Type::Kind::Void)
+ResolvedExpr *Sema::resolveUnaryOperator(const UnaryOperator &unary,
+                                         ResolvedExpr *resolvedRHS) {
+  if (resolvedRHS->type->kind == Type::Kind::Void)
     return report(
         resolvedRHS->location,
         "void expression cannot be used as an operand to unary operator");
 
-  return std::make_unique<ResolvedUnaryOperator>(unary.location, unary.op,
-                                                 std::move(resolvedRHS));
+  if (ResolvedExpr *folded = foldUnaryOperator(unary, resolvedRHS))
+    return folded;
+  return arena->make<ResolvedUnaryOperator>(unary.location, unary.op,
+                                            resolvedRHS);
 }
 
-std::unique_ptr<ResolvedExpr> Sema::resolveExpr(const Expr &expr) {
-
-  if (const auto *number = dynamic_cast<const NumberLiteral *>(&expr))
-    return std::make_unique<ResolvedNumberLiteral>(number->location,
-                                                   std::stod(number->value));
-
-  if (const auto *declRefExpr = dynamic_cast<const DeclRefExpr *>(&expr))
-    return resolveDeclRefExpr(*declRefExpr);
-
-  if (const auto *callExpr = dynamic_cast<const CallExpr *>(&expr))
-    return resolveCallExpr(*callExpr);
-
-  if (const auto *groupingExpr = dynamic_cast<const GroupingExpr *>(&expr))
-    return resolveGroupingExpr(*groupingExpr);
-
-  if (const auto *binaryOperator = dynamic_cast<const BinaryOperator *>(&expr))
-    return resolveBinaryOperator(*binaryOperator);
-
-  if (const auto *unaryOperator = dynamic_cast<const UnaryOperator *>(&expr))
-    return resolveUnaryOperator(*unaryOperator);
+// Walks the expression with an explicit stack, so the depth of the tree is
+// not limited by the call stack. Operands are resolved left to right and
+// the first error aborts the whole expression, like a recursive walk would.
+ResolvedExpr *Sema::resolveExpr(const Expr &expr) {
+  struct Frame {
+    const Expr *expr;
+    // Number of children resolved so far.
+    size_t resolvedChildren = 0;
+    const ResolvedFunctionDecl *callee = nullptr;
+  };
+
+  std::vector<Frame> frames{{&expr}};
+  std::vector<ResolvedExpr *> results;
+
+  auto visit = [&](const Expr *child) {
+    ++frames.back().resolvedChildren;
+    frames.push_back({child});
+  };
+
+  while (!frames.empty()) {
+    Frame &frame = frames.back();
+    const Expr &current = *frame.expr;
+    ResolvedExpr *resolved = nullptr;
+
+    switch (current.getKind()) {
+    case Stmt::Kind::NumberLiteral: {
+      uint32_t constant = llvm::cast<NumberLiteral>(current).constant;
+      resolved = arena->make<ResolvedNumberLiteral>(
+          current.location, constant, ConstantPool::get().getValue(constant));
+      break;
+    }
+    case Stmt::Kind::DeclRefExpr:
+      resolved = resolveDeclRefExpr(llvm::cast<DeclRefExpr>(current));
+      if (!resolved)
+        return nullptr;
+      break;
+    case Stmt::Kind::CallExpr: {
+      const auto &call = llvm::cast<CallExpr>(current);
+      if (frame.resolvedChildren == 0) {
+        frame.callee = resolveCallee(call);
+        if (!frame.callee)
+          return nullptr;
+      } else {
+        ResolvedExpr *arg = results.back();
+        if (arg->type != frame.callee->params[frame.resolvedChildren - 1]->type)
+          return report(arg->location, "unexpected type of argument");
+      }
+
+      if (frame.resolvedChildren < call.arguments.size()) {
+        visit(call.arguments[frame.resolvedChildren]);
+        continue;
+      }
+
+      std::vector<ResolvedExpr *> args(results.end() - call.arguments.size(),
+                                       results.end());
+      results.resize(results.size() - args.size());
+      resolved = arena->make<ResolvedCallExpr>(call.location, *frame.callee,
+                                               arena->copyArray(args));
+      break;
+    }
+    case Stmt::Kind::GroupingExpr: {
+      const auto &grouping = llvm::cast<GroupingExpr>(current);
+      if (frame.resolvedChildren == 0) {
+        visit(grouping.expr);
+        continue;
+      }
+
+      // A parenthesized constant is just the constant.
+      if (auto *literal =
+              llvm::dyn_cast<ResolvedNumberLiteral>(results.back())) {
+        literal->location = grouping.location;
+        resolved = literal;
+      } else {
+        resolved = arena->make<ResolvedGroupingExpr>(grouping.location,
+                                                     results.back());
+      }
+      results.pop_back();
+      break;
+    }
+    case Stmt::Kind::BinaryOperator: {
+      const auto &binop = llvm::cast<BinaryOperator>(current);
+      if (frame.resolvedChildren < 2) {
+        visit(frame.resolvedChildren == 0 ? binop.lhs : binop.rhs);
+        continue;
+      }
+
+      ResolvedExpr *rhs = results.back();
+      results.pop_back();
+      ResolvedExpr *lhs = results.back();
+      results.pop_back();
+      resolved = resolveBinaryOperator(binop, lhs, rhs);
+      if (!resolved)
+        return nullptr;
+      break;
+    }
+    case Stmt::Kind::UnaryOperator: {
+      const auto &unary = llvm::cast<UnaryOperator>(current);
+      if (frame.resolvedChildren == 0) {
+        visit(unary.operand);
+        continue;
+      }
 
-  assert(false && "unexpected expression");
-  return nullptr;
-}
+      ResolvedExpr *operand = results.back();
+      results.pop_back();
+      resolved = resolveUnaryOperator(unary, operand);
+      if (!resolved)
+        return nullptr;
+      break;
+    }
+    default:
+      llvm_unreachable("unexpected expression");
+    }
 
-std::unique_ptr<ResolvedGroupingExpr>
-Sema::resolveGroupingExpr(const GroupingExpr &grouping) {
-  varOrReturn(resolvedExpr, resolveExpr(*grouping.expr));
+    results.emplace_back(resolved);
+    frames.pop_back();
+  }
 
-  return std::make_unique<ResolvedGroupingExpr>(grouping.location,
-                                                std::move(resolvedExpr));
+  return results.back();
 }
 
-std::unique_ptr<ResolvedBlock> Sema::resolveBlock(const Block &block) {
-  std::vector<std::unique_ptr<ResolvedStmt>> resolvedStatements;
+ResolvedBlock *Sema::resolveBlock(const Block &block) {
+  std::vector<ResolvedStmt *> resolvedStatements;
 
   bool error = false;
   int reportUnreachableCount = 0;
@@ -275,7 +505,7 @@ std::unique_ptr<ResolvedBlock> Sema::resolveBlock(const Block &block) {
   for (auto &&stmt : block.statements) {
     auto resolvedStmt = resolveStmt(*stmt);
 
-    error |= !resolvedStatements.emplace_back(std::move(resolvedStmt));
+    error |= !resolvedStatements.emplace_back(resolvedStmt);
     if (error)
       continue;
 
@@ -284,40 +514,42 @@ std::unique_ptr<ResolvedBlock> Sema::resolveBlock(const Block &block) {
       ++reportUnreachableCount;
     }
 
-    if (dynamic_cast<ReturnStmt *>(stmt.get()))
+    if (llvm::isa<ReturnStmt>(stmt))
       ++reportUnreachableCount;
   }
 
   if (error)
     return nullptr;
 
-  return std::make_unique<ResolvedBlock>(block.location,
-                                         std::move(resolvedStatements));
+  return arena->make<ResolvedBlock>(block.location,
+                                    arena->copyArray(resolvedStatements));
 }
 
-std::unique_ptr<ResolvedParamDecl>
+ResolvedParamDecl *
 Sema::resolveParamDecl(const ParamDecl &param) {
-  std::optional<Type> type = resolveType(param.type);
+  const Type *type = resolveType(param.type);
 
   if (!type || type->kind == Type::Kind::Void)
-    return report(param.location, "parameter '" + param.identifier +
-                                      "' has invalid '" + param.type.name +
+    return report(param.location, "parameter '" + std::string(param.identifier.str()) +
+                                      "' has invalid '" +
+                                      std::string(param.type.name.str()) +
                                       "' type");
 
-  return std::make_unique<ResolvedParamDecl>(param.location, param.identifier,
-                                             *type);
+  return arena->make<ResolvedParamDecl>(param.location, param.identifier,
+                                             type);
 }
 
-std::unique_ptr<ResolvedFunctionDecl>
+ResolvedFunctionDecl *
 Sema::resolveFunctionDeclaration(const FunctionDecl &function) {
-  std::optional<Type> type = resolveType(function.type);
+  const Type *type = resolveType(function.type);
 
   if (!type)
-    return report(function.location, "function '" + function.identifier +
+    return report(function.location, "function '" +
+                                         std::string(function.identifier.str()) +
                                          "' has invalid '" +
-                                         function.type.name + "' type");
+                                         std::string(function.type.name.str()) + "' type");
 
-  if (function.identifier == "main") {
+  if (function.identifier == symbols::main) {
     if (type->kind != Type::Kind::Void)
       return report(function.location,
                     "'main' function is expected to have 'void' type");
@@ -328,28 +560,28 @@ Sema::resolveFunctionDeclaration(const FunctionDecl &function) {
   }
 
   ScopeRAII paramScope{this};
-  std::vector<std::unique_ptr<ResolvedParamDecl>> resolvedParams;
+  std::vector<ResolvedParamDecl *> resolvedParams;
   for (auto &&param : function.params) {
     auto resolvedParam = resolveParamDecl(*param);
 
     if (!resolvedParam || !insertDeclToCurrentScope(*resolvedParam))
       return nullptr;
 
-    resolvedParams.emplace_back(std::move(resolvedParam));
+    resolvedParams.emplace_back(resolvedParam);
   }
 
-  return std::make_unique<ResolvedFunctionDecl>(
-      function.location, function.identifier, *type, std::move(resolvedParams),
+  return arena->make<ResolvedFunctionDecl>(
+      function.location, function.identifier, type,
+      arena->copyArray(resolvedParams),
       nullptr);
 };
 
-std::vector<std::unique_ptr<ResolvedFunctionDecl>> Sema::resolveAST() {
-  ScopeRAII globalScope{this};
-  std::vector<std::unique_ptr<ResolvedFunctionDecl>> resolvedTree;
+std::vector<ResolvedFunctionDecl *> Sema::resolveDeclarations() {
+  std::vector<ResolvedFunctionDecl *> resolvedTree;
 
   // Insert print first to be able to detect possible redeclarations.
   auto println = createBuiltinPrintln();
-  insertDeclToCurrentScope(*resolvedTree.emplace_back(std::move(println)));
+  insertDeclToCurrentScope(*resolvedTree.emplace_back(println));
 
   bool error = false;
   for (auto &&fn : ast) {
@@ -361,62 +593,302 @@ std::vector<std::unique_ptr<ResolvedFunctionDecl>> Sema::resolveAST() {
       continue;
     }
 
-    resolvedTree.emplace_back(std::move(resolvedFunctionDecl));
+    resolvedTree.emplace_back(resolvedFunctionDecl);
   }
 
   if (error)
     return {};
+  return resolvedTree;
+}
 
+namespace {
+// Functions whose bodies are resolved first, main if there is one and
+// checkAll is not set, everything else otherwise.
+std::vector<size_t> firstWave(llvm::ArrayRef<ResolvedFunctionDecl *> resolvedTree,
+                              bool checkAll) {
+  std::vector<size_t> wave;
   for (size_t i = 1; i < resolvedTree.size(); ++i) {
-    ScopeRAII scope{this};
-    currentFunction = resolvedTree[i].get();
+    if (resolvedTree[i]->identifier == symbols::main)
+      wave.emplace_back(i);
+  }
+  if (checkAll || wave.empty()) {
+    wave.clear();
+    for (size_t i = 1; i < resolvedTree.size(); ++i)
+      wave.emplace_back(i);
+  }
+  return wave;
+}
+} // namespace
 
-    for (auto &&param : currentFunction->params)
-      insertDeclToCurrentScope(*param);
+std::vector<ResolvedFunctionDecl *> Sema::resolveAST(unsigned jobs) {
+  ScopeRAII globalScope{this};
+  std::vector<ResolvedFunctionDecl *> resolvedTree = resolveDeclarations();
+  if (resolvedTree.empty())
+    return {};
 
-    auto resolvedBody = resolveBlock(*ast[i - 1]->body);
-    if (!resolvedBody) {
-      error = true;
-      continue;
+  // Bodies are resolved in waves, starting at main, each one resolving the
+  // callees the previous one found first. Diagnostics are kept per function
+  // and reported in source order once every wave is done.
+  size_t count = resolvedTree.size();
+  bool error = false;
+  std::unordered_map<const ResolvedFunctionDecl *, size_t> indices;
+  for (size_t i = 1; i < count; ++i)
+    indices.emplace(resolvedTree[i], i);
+  std::vector<size_t> wave = firstWave(resolvedTree, checkAll);
+
+  std::vector<std::vector<const ResolvedFunctionDecl *>> callees(count);
+  std::vector<char> loops(count);
+  std::vector<std::vector<Diagnostic>> diagnostics(count);
+  std::vector<char> resolved(count);
+  for (auto &&i : wave)
+    resolved[i] = true;
+  while (!wave.empty()) {
+    error |=
+        resolveBodies(resolvedTree, wave, jobs, callees, loops, diagnostics);
+
+    std::vector<size_t> next;
+    for (auto &&i : wave) {
+      for (auto &&callee : callees[i]) {
+        auto found = indices.find(callee);
+        if (found == indices.end() || resolved[found->second])
+          continue;
+        resolved[found->second] = true;
+        next.emplace_back(found->second);
+      }
+    }
+    wave = std::move(next);
+  }
+
+  // Reported again, so they reach a capture around resolveAST() as well.
+  for (auto &&functionDiagnostics : diagnostics)
+    for (auto &&diagnostic : functionDiagnostics)
+      report(diagnostic.location, diagnostic.message, diagnostic.isWarning);
+
+  if (error)
+    return {};
+
+  // Functions that were not reached have no callees recorded, but they are
+  // dropped and nothing that is kept calls them.
+  inferEffects(resolvedTree, callees, loops);
+  return selectReachable(resolvedTree, callees);
+}
+
+std::vector<ResolvedFunctionDecl *> Sema::resolveStreaming(
+    const std::function<void(ResolvedFunctionDecl &)> &consume) {
+  ScopeRAII globalScope{this};
+  std::vector<ResolvedFunctionDecl *> resolvedTree = resolveDeclarations();
+  if (resolvedTree.empty())
+    return {};
+
+  size_t count = resolvedTree.size();
+  bool error = false;
+  std::unordered_map<const ResolvedFunctionDecl *, size_t> indices;
+  for (size_t i = 1; i < count; ++i)
+    indices.emplace(resolvedTree[i], i);
+
+  std::vector<std::vector<const ResolvedFunctionDecl *>> callees(count);
+  std::vector<char> loops(count);
+  std::vector<std::vector<Diagnostic>> diagnostics(count);
+  std::vector<char> resolved(count);
+
+  // Each body is parsed and resolved into an arena of its own, which is
+  // released once 'consume' is done with it.
+  Arena *globalArena = arena;
+  auto resolveAndRelease = [&](size_t i, bool isReachable) {
+    FunctionDecl &fn = *ast[i - 1];
+    bool isDeferred = !fn.body;
+    Arena bodyArena;
+    setArena(bodyArena);
+    {
+      DiagnosticCapture capture;
+      error |= !resolveFunctionBody(*resolvedTree[i], fn);
+      callees[i] = std::move(calledFunctions);
+      loops[i] = loopInBody;
+      diagnostics[i] = capture.takeDiagnostics();
     }
+    if (!error && isReachable)
+      consume(*resolvedTree[i]);
+
+    resolvedTree[i]->body = nullptr;
+    if (isDeferred)
+      fn.body = nullptr;
+  };
+
+  consume(*resolvedTree[0]);
+
+  // The same functions as the waves of resolveAST(), one at a time.
+  std::vector<size_t> worklist = firstWave(resolvedTree, false);
+  std::reverse(worklist.begin(), worklist.end());
+  for (auto &&i : worklist)
+    resolved[i] = true;
+  while (!worklist.empty()) {
+    size_t i = worklist.back();
+    worklist.pop_back();
+    resolveAndRelease(i, true);
+
+    for (auto &&callee : callees[i]) {
+      auto found = indices.find(callee);
+      if (found == indices.end() || resolved[found->second])
+        continue;
+      resolved[found->second] = true;
+      worklist.emplace_back(found->second);
+    }
+  }
 
-    currentFunction->body = std::move(resolvedBody);
+  // Only checked, they are not part of the module.
+  if (checkAll) {
+    for (size_t i = 1; i < count; ++i)
+      if (!resolved[i])
+        resolveAndRelease(i, false);
   }
+  setArena(*globalArena);
+
+  for (auto &&functionDiagnostics : diagnostics)
+    for (auto &&diagnostic : functionDiagnostics)
+      report(diagnostic.location, diagnostic.message, diagnostic.isWarning);
 
   if (error)
     return {};
 
-  return std::move(resolvedTree);
+  inferEffects(resolvedTree, callees, loops);
+  return selectReachable(resolvedTree, callees);
+}
+
+bool Sema::resolveBodies(
+    llvm::ArrayRef<ResolvedFunctionDecl *> resolvedTree,
+    llvm::ArrayRef<size_t> functions, unsigned jobs,
+    std::vector<std::vector<const ResolvedFunctionDecl *>> &callees,
+    std::vector<char> &loops, std::vector<std::vector<Diagnostic>> &diagnostics) {
+  bool error = false;
+  if (jobs <= 1 || functions.size() <= 1) {
+    for (auto &&i : functions) {
+      DiagnosticCapture capture;
+      error |= !resolveFunctionBody(*resolvedTree[i], *ast[i - 1]);
+      callees[i] = std::move(calledFunctions);
+      loops[i] = loopInBody;
+      diagnostics[i] = capture.takeDiagnostics();
+    }
+    return error;
+  }
+
+  // With the signatures resolved, a body only reads the global scope. Bodies
+  // are resolved in contiguous groups, each by a worker with its own arena
+  // and local scopes.
+  size_t count = functions.size();
+  size_t groupCount = std::min<size_t>(count, jobs * 4);
+  std::vector<Arena> arenas(groupCount);
+  std::vector<char> failed(count);
+  std::vector<std::vector<ResolvedNumberLiteral *>> unpooled(groupCount);
+  parallelFor(groupCount, jobs, [&](size_t group) {
+    Sema worker(*this, arenas[group]);
+    size_t begin = count * group / groupCount;
+    size_t end = count * (group + 1) / groupCount;
+    for (size_t i = begin; i < end; ++i) {
+      size_t idx = functions[i];
+      DiagnosticCapture capture;
+      failed[i] = !worker.resolveFunctionBody(*resolvedTree[idx], *ast[idx - 1]);
+      callees[idx] = std::move(worker.calledFunctions);
+      loops[idx] = worker.loopInBody;
+      diagnostics[idx] = capture.takeDiagnostics();
+    }
+    unpooled[group] = std::move(worker.unpooledLiterals);
+  });
+
+  for (auto &&groupArena : arenas)
+    arena->adopt(std::move(groupArena));
+  // In resolution order, so the pool ends up like after a serial run.
+  for (auto &&literals : unpooled)
+    for (auto &&literal : literals)
+      literal->constant = ConstantPool::get().intern(literal->value);
+
+  for (auto &&f : failed)
+    error |= f;
+  return error;
+}
+
+std::vector<ResolvedFunctionDecl *> Sema::selectReachable(
+    llvm::ArrayRef<ResolvedFunctionDecl *> module,
+    llvm::ArrayRef<std::vector<const ResolvedFunctionDecl *>> callees) {
+  std::unordered_map<const ResolvedFunctionDecl *, size_t> indices;
+  std::vector<size_t> worklist;
+  for (size_t i = 0; i < module.size(); ++i) {
+    indices.emplace(module[i], i);
+    if (i != 0 && module[i]->identifier == symbols::main)
+      worklist.emplace_back(i);
+  }
+  if (worklist.empty())
+    return module.vec();
+
+  std::vector<char> reached(module.size());
+  reached[0] = true;
+  reached[worklist.front()] = true;
+  while (!worklist.empty()) {
+    size_t i = worklist.back();
+    worklist.pop_back();
+    for (auto &&callee : callees[i]) {
+      auto found = indices.find(callee);
+      if (found == indices.end() || reached[found->second])
+        continue;
+      reached[found->second] = true;
+      worklist.emplace_back(found->second);
+    }
+  }
+
+  std::vector<ResolvedFunctionDecl *> reachable;
+  for (size_t i = 0; i < module.size(); ++i)
+    if (reached[i])
+      reachable.emplace_back(module[i]);
+  return reachable;
+}
+
+bool Sema::resolveFunctionBody(ResolvedFunctionDecl &function,
+                               FunctionDecl &fn) {
+  ScopeRAII scope{this};
+  currentFunction = &function;
+  function.body = nullptr;
+  calledFunctions.clear();
+  loopInBody = false;
+
+  for (auto &&param : function.params)
+    insertDeclToCurrentScope(*param);
+
+  if (!fn.body && !bodyParser(fn, *arena))
+    return false;
+
+  function.body = resolveBlock(*fn.body);
+  if (function.body)
+    inferIntegers(function);
+  return function.body;
 }
 
-std::unique_ptr<ResolvedVarDecl> Sema::resolveVarDecl(const VarDecl &varDecl){
+ResolvedVarDecl *Sema::resolveVarDecl(const VarDecl &varDecl){
   
   if(!varDecl.type&&!varDecl.initializer)
     return report(varDecl.location, "uninitialized variable is expected to have a type specifier");
   
-  std::unique_ptr<ResolvedExpr> resolvedInitializer=nullptr;
+  ResolvedExpr *resolvedInitializer=nullptr;
   if(varDecl.initializer){
     resolvedInitializer=resolveExpr(*varDecl.initializer);
     if(!resolvedInitializer)
       return nullptr;
   }
 
-  Type resolvableType=varDecl.type.value_or(resolvedInitializer->type);
-  auto type=resolveType(resolvableType);
+  const Type &resolvableType=varDecl.type?*varDecl.type:*resolvedInitializer->type;
+  const Type *type=resolveType(resolvableType);
   if(!type ||type->kind==Type::Kind::Void)
-    return report(varDecl.location,"variable '"+varDecl.identifier+"' has invalid '"+resolvableType.name+"' type");
+    return report(varDecl.location,"variable '"+std::string(varDecl.identifier.str())+"' has invalid '"+std::string(resolvableType.name.str())+"' type");
 
-  if(resolvedInitializer->type.kind!=type->kind)
+  if(resolvedInitializer && resolvedInitializer->type!=type)
       return report(resolvedInitializer->location, "initializer type mismatch");
-  return std::make_unique<ResolvedVarDecl>(varDecl.location,varDecl.identifier,*type,varDecl.isMutable,std::move(resolvedInitializer));
+  return arena->make<ResolvedVarDecl>(varDecl.location,varDecl.identifier,type,varDecl.isMutable,resolvedInitializer);
 }
 
-std::unique_ptr<ResolvedDeclStmt> Sema::resolveDeclStmt(const DeclStmt &declStmt){
+ResolvedDeclStmt *Sema::resolveDeclStmt(const DeclStmt &declStmt){
   varOrReturn(resolvedVarDecl, resolveVarDecl(*declStmt.varDecl));
   if(!insertDeclToCurrentScope(*resolvedVarDecl))
     return nullptr;
 
-  return std::make_unique<ResolvedDeclStmt>(declStmt.location,std::move(resolvedVarDecl));
+  return arena->make<ResolvedDeclStmt>(declStmt.location,resolvedVarDecl);
 }
 
 
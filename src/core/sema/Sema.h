@@ -1,46 +1,136 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
 #include <memory>
-#include <optional>
+#include "../../utils/Arena.h"
+#include "../../utils/Utils.h"
 #include "../ast/ResolvedAst.h"
+#include "../ast/TypeContext.h"
 
 namespace hlx{
 
     class Sema{
-        std::vector<std::unique_ptr<FunctionDecl>> ast;
-        std::vector<std::vector<ResolvedDecl*>> scopes;
+        std::vector<FunctionDecl *> ast;
+        Arena *arena;
+        // Only builtin types are resolved, so workers may share it.
+        TypeContext &types=TypeContext::get();
+        // Symbol table: every visible decl has a binding, bindings of inner
+        // scopes come later. A binding remembers the one of the same name
+        // it shadows, so leaving a scope just unwinds its bindings.
+        struct Binding{
+            ResolvedDecl *decl;
+            uint32_t symbol;
+            uint32_t depth;
+            int32_t shadowed;
+        };
+        std::vector<Binding> bindings;
+        // Index of the innermost binding of each symbol id, -1 if none.
+        std::vector<int32_t> innermost;
+        // Number of bindings when each open scope was entered.
+        std::vector<size_t> scopeStarts;
+
+        void enterScope(){scopeStarts.emplace_back(bindings.size());}
+        // println followed by the signatures of 'ast', inserted into the open
+        // global scope. Empty if any of them is invalid.
+        std::vector<ResolvedFunctionDecl *> resolveDeclarations();
+        void exitScope();
+        // Resolves the bodies of resolvedTree[i] for every i in 'functions' on
+        // up to 'jobs' threads, recording their callees, whether they loop
+        // and their diagnostics at i. Returns whether any body failed to
+        // resolve.
+        bool resolveBodies(llvm::ArrayRef<ResolvedFunctionDecl *> resolvedTree,llvm::ArrayRef<size_t> functions,unsigned jobs,
+                           std::vector<std::vector<const ResolvedFunctionDecl *>> &callees,std::vector<char> &loops,
+                           std::vector<std::vector<Diagnostic>> &diagnostics);
 
         ResolvedFunctionDecl *currentFunction;
+        // Parses bodies the parser deferred into the given arena, see
+        // Parser::setLazyBodies().
+        std::function<Block *(FunctionDecl &,Arena &)> bodyParser;
+        // Lookups that find nothing in the scopes of this Sema continue
+        // here, see the worker constructor.
+        const Sema *enclosing=nullptr;
+        // Resolve every body instead of only the ones reachable from main.
+        bool checkAll=false;
+        // Functions called by the body resolved last, with repetitions.
+        std::vector<const ResolvedFunctionDecl *> calledFunctions;
+        // Whether the body resolved last contains a loop.
+        bool loopInBody=false;
+        // Literals a worker folded, pooled by the enclosing Sema once the
+        // workers are done since the ConstantPool is not thread-safe.
+        std::vector<ResolvedNumberLiteral *> unpooledLiterals;
+
+        ResolvedNumberLiteral *makeConstant(SourceLocation location,double value);
+        // Constant folding and identities that hold for every double,
+        // null if the operator has to be evaluated at runtime.
+        ResolvedExpr *foldBinaryOperator(const BinaryOperator &binop,ResolvedExpr *lhs,ResolvedExpr *rhs);
+        ResolvedExpr *foldUnaryOperator(const UnaryOperator &unary,ResolvedExpr *operand);
 
 
     public:
-        explicit Sema(std::vector<std::unique_ptr<FunctionDecl>> ast)
-        :ast(std::move(ast)){}
-        std::unique_ptr<ResolvedFunctionDecl> resolveFunctionDeclaration(const FunctionDecl &function);
-        std::unique_ptr<ResolvedCallExpr> resolveCallExpr(const CallExpr &call);
-        std::unique_ptr<ResolvedDeclRefExpr> resolveDeclRefExpr(const DeclRefExpr &declRefExpr,bool isCallee=false);
-        std::unique_ptr<ResolvedExpr> resolveExpr(const Expr &expr);
-        std::unique_ptr<ResolvedBlock> resolveBlock(const Block &block);
-        std::unique_ptr<ResolvedParamDecl> resolveParamDecl(const ParamDecl &param);
-        std::unique_ptr<ResolvedStmt> resolveStmt(const Stmt &stmt);
-        std::unique_ptr<ResolvedReturnStmt> resolveReturnStmt(const ReturnStmt &returnStmt);
-        std::optional<Type> resolveType(Type parsedType);
-        std::vector<std::unique_ptr<ResolvedFunctionDecl>> resolveSourceFile();
-        std::vector<std::unique_ptr<ResolvedFunctionDecl>> resolveAST();
-        std::unique_ptr<ResolvedBinaryOperator> resolveBinaryOperator(const BinaryOperator &binop);
-        std::unique_ptr<ResolvedUnaryOperator> resolveUnaryOperator(const UnaryOperator &unary);
-        std::unique_ptr<ResolvedGroupingExpr> resolveGroupingExpr(const GroupingExpr &grouping);
-        std::unique_ptr<ResolvedIfStmt> resolveIfStmt(const IfStmt &ifStmt);
-        std::unique_ptr<ResolvedWhileStmt> resolveWhileStmt(const WhileStmt &whileStmt);
-
-        std::unique_ptr<ResolvedDeclStmt> resolveDeclStmt(const DeclStmt &declStmt);
-        std::unique_ptr<ResolvedVarDecl> resolveVarDecl(const VarDecl &varDecl);
-        std::unique_ptr<ResolvedAssignment> resolveAssignment(const Assignment &assignment);
+        // Resolved nodes are allocated in 'arena'.
+        Sema(std::vector<FunctionDecl *> ast,Arena &arena)
+        :ast(std::move(ast)),arena(&arena){}
+        // A worker that resolves bodies with scopes of its own on top of the
+        // global scope of 'enclosing', which is only read. Several workers
+        // can share one enclosing Sema.
+        Sema(const Sema &enclosing,Arena &arena)
+        :arena(&arena),bodyParser(enclosing.bodyParser),enclosing(&enclosing){}
+        void setBodyParser(std::function<Block *(FunctionDecl &,Arena &)> parser){
+            bodyParser=std::move(parser);
+        }
+        void setCheckAll(bool check){checkAll=check;}
+        // Nodes resolved from now on are allocated in 'newArena'.
+        void setArena(Arena &newArena){arena=&newArena;}
+        ResolvedFunctionDecl *resolveFunctionDeclaration(const FunctionDecl &function);
+        const ResolvedFunctionDecl *resolveCallee(const CallExpr &call);
+        ResolvedDeclRefExpr *resolveDeclRefExpr(const DeclRefExpr &declRefExpr,bool isCallee=false);
+        ResolvedExpr *resolveExpr(const Expr &expr);
+        ResolvedBlock *resolveBlock(const Block &block);
+        ResolvedParamDecl *resolveParamDecl(const ParamDecl &param);
+        ResolvedStmt *resolveStmt(const Stmt &stmt);
+        ResolvedReturnStmt *resolveReturnStmt(const ReturnStmt &returnStmt);
+        // Null if 'parsedType' names no type.
+        const Type *resolveType(const Type &parsedType);
+        std::vector<ResolvedFunctionDecl *> resolveSourceFile();
+        // Only the functions reachable from main are resolved and returned,
+        // after println, unless there is no main or checkAll is set, which
+        // resolves every body for its diagnostics. Their effects are
+        // inferred, see inferEffects(). Bodies are resolved on up to 'jobs'
+        // threads, the diagnostics are the same and in the same order.
+        std::vector<ResolvedFunctionDecl *> resolveAST(unsigned jobs=1);
+        // Like resolveAST() on one thread, but every body main reaches is
+        // handed to 'consume' right after it is resolved, println's first,
+        // and released afterwards, along with its AST if that was parsed
+        // lazily. So at most one body is alive at a time. Nothing is consumed
+        // after an error. The returned functions have no bodies.
+        std::vector<ResolvedFunctionDecl *> resolveStreaming(const std::function<void(ResolvedFunctionDecl &)> &consume);
+        // Resolves the body of 'fn' into 'function', with the global scope
+        // open. On failure function.body is left null.
+        bool resolveFunctionBody(ResolvedFunctionDecl &function,FunctionDecl &fn);
+        llvm::ArrayRef<const ResolvedFunctionDecl *> getCalledFunctions() const{return calledFunctions;}
+        bool hasLoopInBody() const{return loopInBody;}
+        // The functions of 'module' that main reaches through the calls in
+        // 'callees', which holds the callees of module[i] at i, in module
+        // order. println stays first, without main everything is kept.
+        static std::vector<ResolvedFunctionDecl *> selectReachable(llvm::ArrayRef<ResolvedFunctionDecl *> module,
+                                                                   llvm::ArrayRef<std::vector<const ResolvedFunctionDecl *>> callees);
+        ResolvedExpr *resolveBinaryOperator(const BinaryOperator &binop,ResolvedExpr *lhs,ResolvedExpr *rhs);
+        ResolvedExpr *resolveUnaryOperator(const UnaryOperator &unary,ResolvedExpr *operand);
+        ResolvedIfStmt *resolveIfStmt(const IfStmt &ifStmt);
+        ResolvedWhileStmt *resolveWhileStmt(const WhileStmt &whileStmt);
+
+        ResolvedDeclStmt *resolveDeclStmt(const DeclStmt &declStmt);
+        ResolvedVarDecl *resolveVarDecl(const VarDecl &varDecl);
+        ResolvedAssignment *resolveAssignment(const Assignment &assignment);
         
-        std::unique_ptr<ResolvedFunctionDecl> createBuiltinPrintln();
-        std::pair<ResolvedDecl *,int> lookupDecl(const std::string id);
+        ResolvedFunctionDecl *createBuiltinPrintln();
+        std::pair<ResolvedDecl *,int> lookupDecl(Symbol id) const;
 
         bool insertDeclToCurrentScope(ResolvedDecl &decl);
+        // For IncrementalFrontend, which keeps the global scope open across
+        // edits and withdraws the functions that are gone.
+        void removeGlobalDecl(const ResolvedDecl &decl);
 
         class ScopeRAII{
             Sema *sema;
@@ -48,9 +138,9 @@ namespace hlx{
         public:
             explicit ScopeRAII(Sema *sema)
             : sema(sema){
-                sema->scopes.emplace_back();
+                sema->enterScope();
             }
-            ~ScopeRAII(){sema->scopes.pop_back();}
+            ~ScopeRAII(){sema->exitScope();}
         };
     };
 
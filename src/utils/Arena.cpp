@@ -0,0 +1,25 @@
+#include "Arena.h"
+#include <iterator>
+
+void *hlx::Arena::allocateSlow(size_t size, size_t align) {
+  // Oversized requests get a slab of their own, so the current slab keeps
+  // serving small nodes.
+  size_t needed = size + align - 1;
+  if (needed > slabSize / 4) {
+    auto &slab = slabs.emplace_back(new char[needed]);
+    uintptr_t addr = reinterpret_cast<uintptr_t>(slab.get());
+    return reinterpret_cast<char *>((addr + align - 1) & ~(align - 1));
+  }
+
+  auto &slab = slabs.emplace_back(new char[slabSize]);
+  cur = slab.get();
+  end = cur + slabSize;
+  return allocate(size, align);
+}
+
+void hlx::Arena::adopt(Arena &&other) {
+  slabs.insert(slabs.end(), std::make_move_iterator(other.slabs.begin()),
+               std::make_move_iterator(other.slabs.end()));
+  other.slabs.clear();
+  other.cur = other.end = nullptr;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <llvm/ADT/ArrayRef.h>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace hlx {
+// Bump-pointer allocator owning the nodes of a tree. Everything is released
+// at once when the arena is destroyed; destructors of the objects allocated
+// here never run, so they must not own memory outside the arena.
+class Arena {
+  static constexpr size_t slabSize = 64 * 1024;
+
+  std::vector<std::unique_ptr<char[]>> slabs;
+  char *cur = nullptr;
+  char *end = nullptr;
+
+  void *allocateSlow(size_t size, size_t align);
+
+public:
+  Arena() = default;
+  // The source is left empty, its bump pointer must not keep pointing into
+  // a slab it no longer owns.
+  Arena(Arena &&other)
+      : slabs(std::move(other.slabs)), cur(std::exchange(other.cur, nullptr)),
+        end(std::exchange(other.end, nullptr)) {
+    other.slabs.clear();
+  }
+  Arena &operator=(Arena &&other) {
+    if (this != &other) {
+      slabs = std::move(other.slabs);
+      other.slabs.clear();
+      cur = std::exchange(other.cur, nullptr);
+      end = std::exchange(other.end, nullptr);
+    }
+    return *this;
+  }
+
+  // Takes over the slabs of 'other', e.g. the arena a worker thread built
+  // its part of a tree in. Nodes in it stay valid for the lifetime of this
+  // arena.
+  void adopt(Arena &&other);
+
+  void *allocate(size_t size, size_t align) {
+    size_t padding = -reinterpret_cast<uintptr_t>(cur) & (align - 1);
+    if (static_cast<size_t>(end - cur) < size + padding)
+      return allocateSlow(size, align);
+
+    char *ptr = cur + padding;
+    cur = ptr + size;
+    return ptr;
+  }
+
+  template <typename T, typename... Args> T *make(Args &&...args) {
+    return new (allocate(sizeof(T), alignof(T)))
+        T(std::forward<Args>(args)...);
+  }
+
+  template <typename T>
+  llvm::MutableArrayRef<T> copyArray(const std::vector<T> &values) {
+    if (values.empty())
+      return {};
+
+    T *data =
+        static_cast<T *>(allocate(sizeof(T) * values.size(), alignof(T)));
+    std::uninitialized_copy(values.begin(), values.end(), data);
+    return {data, values.size()};
+  }
+
+  std::string_view copyString(std::string_view str) {
+    char *data = static_cast<char *>(allocate(str.size(), 1));
+    std::memcpy(data, str.data(), str.size());
+    return {data, str.size()};
+  }
+};
+} // namespace hlx
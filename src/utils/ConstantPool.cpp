@@ -0,0 +1,18 @@
+#include "ConstantPool.h"
+#include <cstring>
+
+hlx::ConstantPool &hlx::ConstantPool::get() {
+  static ConstantPool constantPool;
+  return constantPool;
+}
+
+uint32_t hlx::ConstantPool::intern(double value) {
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+
+  auto [it, inserted] = indices.try_emplace(bits, values.size());
+  if (inserted)
+    values.emplace_back(value);
+
+  return it->second;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace hlx {
+// Deduplicated storage for the numeric constants of a module. Literals are
+// converted once by the lexer and referenced by index afterwards.
+class ConstantPool {
+  std::vector<double> values;
+  // Keyed by bit pattern, so -0.0 and 0.0 stay distinct.
+  std::unordered_map<uint64_t, uint32_t> indices;
+
+public:
+  static ConstantPool &get();
+
+  uint32_t intern(double value);
+  double getValue(uint32_t idx) const { return values[idx]; }
+  size_t size() const { return values.size(); }
+};
+} // namespace hlx
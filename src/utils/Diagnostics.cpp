@@ -0,0 +1,78 @@
+#include "Diagnostics.h"
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <utility>
+
+struct hlx::DiagnosticEngine::ThreadBuffer {
+  std::vector<Diagnostic> diagnostics;
+
+  ~ThreadBuffer() {
+    if (!diagnostics.empty())
+      DiagnosticEngine::get().publish(std::move(diagnostics));
+  }
+};
+
+thread_local hlx::DiagnosticEngine::ThreadBuffer
+    hlx::DiagnosticEngine::threadBuffer;
+
+hlx::DiagnosticEngine &hlx::DiagnosticEngine::get() {
+  static DiagnosticEngine diagnosticEngine;
+  return diagnosticEngine;
+}
+
+void hlx::DiagnosticEngine::report(Diagnostic diagnostic) {
+  threadBuffer.diagnostics.emplace_back(std::move(diagnostic));
+}
+
+void hlx::DiagnosticEngine::publish(std::vector<Diagnostic> diagnostics) {
+  auto *batch = new Batch{std::move(diagnostics), batches.load()};
+  while (!batches.compare_exchange_weak(batch->next, batch))
+    ;
+}
+
+void hlx::DiagnosticEngine::flush() {
+  if (!threadBuffer.diagnostics.empty())
+    publish(std::move(threadBuffer.diagnostics));
+  threadBuffer.diagnostics.clear();
+
+  // The list is newest first.
+  std::vector<Batch *> taken;
+  for (Batch *batch = batches.exchange(nullptr); batch; batch = batch->next)
+    taken.emplace_back(batch);
+
+  std::vector<Diagnostic> diagnostics;
+  for (auto it = taken.rbegin(); it != taken.rend(); ++it) {
+    for (auto &&diagnostic : (*it)->diagnostics)
+      diagnostics.emplace_back(std::move(diagnostic));
+    delete *it;
+  }
+  std::stable_sort(diagnostics.begin(), diagnostics.end(),
+                   [](const Diagnostic &lhs, const Diagnostic &rhs) {
+                     return lhs.location.offset < rhs.location.offset;
+                   });
+
+  std::string formatted;
+  size_t dropped = 0;
+  for (auto &&diagnostic : diagnostics) {
+    if (errorLimit && errorCount >= errorLimit) {
+      errorCount += !diagnostic.isWarning;
+      dropped += !diagnostic.isWarning;
+      continue;
+    }
+    errorCount += !diagnostic.isWarning;
+
+    if (consumer)
+      consumer(diagnostic);
+    else
+      formatted += formatDiagnostic(diagnostic);
+  }
+  if (dropped && !consumer)
+    formatted += "error: too many errors, " + std::to_string(dropped) +
+                 " more not shown\n";
+
+  if (!formatted.empty()) {
+    std::fwrite(formatted.data(), 1, formatted.size(), stderr);
+    std::fflush(stderr);
+  }
+}
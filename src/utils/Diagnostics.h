@@ -0,0 +1,50 @@
+#pragma once
+#include "Utils.h"
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace hlx {
+// Receives the diagnostics reported outside of any DiagnosticCapture, on
+// any thread. Each thread appends to a buffer of its own without locking,
+// and hands it over through a lock-free list when it exits or flushes.
+//
+// flush() orders everything handed over so far by source location, keeping
+// the order in which diagnostics at the same location were reported, and
+// writes it to stderr in a single write, or passes it to the consumer.
+class DiagnosticEngine {
+  struct Batch {
+    std::vector<Diagnostic> diagnostics;
+    Batch *next;
+  };
+
+  std::atomic<Batch *> batches = nullptr;
+  std::function<void(const Diagnostic &)> consumer;
+  size_t errorLimit = 20;
+  size_t errorCount = 0;
+
+  struct ThreadBuffer;
+  static thread_local ThreadBuffer threadBuffer;
+  void publish(std::vector<Diagnostic> diagnostics);
+
+public:
+  static DiagnosticEngine &get();
+
+  void report(Diagnostic diagnostic);
+  // Flushes the buffer of the calling thread along with those of the
+  // threads that already exited.
+  void flush();
+
+  // Once 'limit' errors are flushed, everything after them is dropped, 0
+  // means no limit.
+  void setErrorLimit(size_t limit) { errorLimit = limit; }
+  // Flushed diagnostics go to 'newConsumer' instead of stderr, e.g. when
+  // the compiler is used as a library.
+  void setConsumer(std::function<void(const Diagnostic &)> newConsumer) {
+    consumer = std::move(newConsumer);
+  }
+  // Errors flushed so far, including the dropped ones.
+  size_t getErrorCount() const { return errorCount; }
+};
+} // namespace hlx
@@ -1,9 +1,30 @@
 #include "Driver.h"
+#include "Diagnostics.h"
+#include <cctype>
+#include <cerrno>
 #include <cstdlib>
 #include <iostream>
+#include <limits>
 #include <string_view>
 
 namespace hlx {
+namespace {
+// A decimal number that fits an unsigned, nothing else, no sign either.
+bool parseCount(const char *text, unsigned &count) {
+  if (!std::isdigit(static_cast<unsigned char>(*text)))
+    return false;
+
+  char *end = nullptr;
+  errno = 0;
+  unsigned long value = std::strtoul(text, &end, 10);
+  if (*end || errno == ERANGE || value > std::numeric_limits<unsigned>::max())
+    return false;
+
+  count = value;
+  return true;
+}
+} // namespace
+
 CompilerOptions parseArguments(int argc, const char **argv) {
   CompilerOptions options;
 
@@ -21,6 +42,11 @@ CompilerOptions parseArguments(int argc, const char **argv) {
         options.displayHelp = true;
       else if (arg == "-o")
         options.output = ++idx >= argc ? "" : argv[idx];
+      else if (arg == "-emit-res") {
+        if (++idx >= argc)
+          error("expected a file name after '-emit-res'");
+        options.emitRes = argv[idx];
+      }
       else if (arg == "-ast-dump")
         options.astDump = true;
       else if (arg=="-res-dump")
@@ -29,6 +55,33 @@ CompilerOptions parseArguments(int argc, const char **argv) {
         options.llvmDump = true;
       else if (arg == "-cfg-dump")
         options.cfgDump = true;
+      else if (arg == "-prelex")
+        options.preLex = true;
+      else if (arg == "-pipeline")
+        options.pipeline = true;
+      else if (arg == "-lazy-bodies")
+        options.lazyBodies = true;
+      else if (arg == "-stream")
+        options.stream = true;
+      else if (arg == "-fctfe")
+        options.ctfe = true;
+      else if (arg == "-fcheck-all")
+        options.checkAll = true;
+      // Entry point of the parallel lexing tests, not meant for users.
+      else if (arg == "-verify-lex")
+        options.verifyLex = true;
+      else if (arg == "-verify-incremental")
+        options.verifyIncremental = true;
+      else if (arg == "-j") {
+        if (++idx >= argc || !parseCount(argv[idx], options.jobs) ||
+            options.jobs == 0)
+          error("expected a positive number of jobs after '-j'");
+      }
+      else if (arg == "-ferror-limit") {
+        if (++idx >= argc || !parseCount(argv[idx], options.errorLimit))
+          error("expected a non-negative number of errors after "
+                "'-ferror-limit'");
+      }
       else
         error("unexpected option '" + std::string(arg) + '\'');
     }
@@ -39,18 +92,38 @@ CompilerOptions parseArguments(int argc, const char **argv) {
 }
 
 [[noreturn]] void error(std::string_view msg) {
+  DiagnosticEngine::get().flush();
   std::cerr << "error: " << msg << '\n';
   std::exit(1);
 }
 
 void displayHelp() {
   std::cout << "Usage:\n"
-            << "  compiler [options] <source_file>\n\n"
+            << "  compiler [options] <source_file>\n"
+            << "  <source_file> is a .hlx source or a .hlxr resolved module\n\n"
             << "Options:\n"
             << "  -h           display this message\n"
             << "  -o <file>    write executable to <file>\n"
             << "  -ast-dump    print the abstract syntax tree\n"
             << "  -res-dump    print the resolved syntax tree\n"
-            << "  -llvm-dump   print the llvm module\n";
+            << "  -llvm-dump   print the llvm module\n"
+            << "  -emit-res <file>\n"
+            << "               write the resolved module to <file>\n"
+            << "  -prelex      lex the whole file before parsing\n"
+            << "  -pipeline    lex on a separate thread while parsing\n"
+            << "  -j <n>       use up to <n> threads (implies -prelex)\n"
+            << "  -lazy-bodies parse function bodies when first needed\n"
+            << "               (implies -prelex)\n"
+            << "  -stream      resolve and lower one function at a time,\n"
+            << "               releasing its trees (implies -lazy-bodies)\n"
+            << "  -fctfe       evaluate calls with constant arguments at\n"
+            << "               compile time\n"
+            << "  -fcheck-all  also check functions main never calls\n"
+            << "  -ferror-limit <n>\n"
+            << "               stop showing errors after <n> (default 20,\n"
+            << "               0 for no limit)\n"
+            << "  -verify-incremental\n"
+            << "               check reparsing after edits against a full\n"
+            << "               compilation\n";
 }
 } // namespace hlx
\ No newline at end of file
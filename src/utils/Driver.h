@@ -4,11 +4,22 @@ namespace hlx{
     struct CompilerOptions{
         std::filesystem::path source;
         std::filesystem::path output;
+        std::filesystem::path emitRes;
         bool displayHelp=false;
         bool astDump=false;
         bool resDump=false;
         bool llvmDump=false;
         bool cfgDump=false;
+        bool preLex=false;
+        bool verifyLex=false;
+        bool verifyIncremental=false;
+        bool pipeline=false;
+        bool lazyBodies=false;
+        bool stream=false;
+        bool ctfe=false;
+        bool checkAll=false;
+        unsigned jobs=1;
+        unsigned errorLimit=20;
     };
     CompilerOptions parseArguments(int argc,const char **argv);
     void displayHelp();
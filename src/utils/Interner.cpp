@@ -0,0 +1,30 @@
+#include "Interner.h"
+
+std::string_view hlx::Symbol::str() const {
+  return Interner::get().getName(*this);
+}
+
+std::ostream &hlx::operator<<(std::ostream &os, Symbol symbol) {
+  return os << symbol.str();
+}
+
+hlx::Interner::Interner() {
+  for (std::string_view name : {"", "main", "println", "n", "void", "number"})
+    intern(name);
+}
+
+hlx::Interner &hlx::Interner::get() {
+  static Interner interner;
+  return interner;
+}
+
+hlx::Symbol hlx::Interner::intern(std::string_view name) {
+  auto it = ids.find(name);
+  if (it != ids.end())
+    return Symbol(it->second);
+
+  uint32_t id = names.size();
+  names.emplace_back(arena.copyString(name));
+  ids.emplace(names.back(), id);
+  return Symbol(id);
+}
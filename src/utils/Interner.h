@@ -0,0 +1,68 @@
+#pragma once
+#include "Arena.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace hlx {
+// 32-bit handle of an interned identifier. Two symbols are equal exactly when
+// their spellings are, so names compare and hash as integers.
+class Symbol {
+  uint32_t id = 0;
+
+public:
+  constexpr Symbol() = default;
+  constexpr explicit Symbol(uint32_t id) : id(id) {}
+
+  constexpr uint32_t getId() const { return id; }
+  // Spelling of the symbol in Interner::get().
+  std::string_view str() const;
+
+  constexpr bool operator==(Symbol other) const { return id == other.id; }
+  constexpr bool operator!=(Symbol other) const { return id != other.id; }
+};
+
+std::ostream &operator<<(std::ostream &os, Symbol symbol);
+
+// Names the compiler refers to by itself. Every Interner starts out with
+// them in this order, so their symbols are constants.
+namespace symbols {
+constexpr Symbol empty{0};
+constexpr Symbol main{1};
+constexpr Symbol println{2};
+constexpr Symbol n{3};
+constexpr Symbol kwVoid{4};
+constexpr Symbol kwNumber{5};
+} // namespace symbols
+
+// Identifier table of a compilation. The lexer interns every identifier
+// once, later stages only pass Symbols around. Spellings live in an arena,
+// so the views returned by getName() stay valid.
+//
+// Not thread-safe. Parallel lexers intern into private tables that are
+// merged in source order, and nothing may read the table while a lexer
+// running on another thread interns into it.
+class Interner {
+  Arena arena;
+  std::vector<std::string_view> names;
+  std::unordered_map<std::string_view, uint32_t> ids;
+
+public:
+  Interner();
+  static Interner &get();
+
+  Symbol intern(std::string_view name);
+  std::string_view getName(Symbol symbol) const {
+    return names[symbol.getId()];
+  }
+  size_t size() const { return names.size(); }
+};
+} // namespace hlx
+
+template <> struct std::hash<hlx::Symbol> {
+  size_t operator()(hlx::Symbol symbol) const { return symbol.getId(); }
+};
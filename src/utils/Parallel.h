@@ -0,0 +1,33 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace hlx {
+// Runs fn(0) ... fn(count - 1) on up to 'jobs' threads. Indices are handed
+// out dynamically, so uneven work items still keep every thread busy.
+template <typename Fn> void parallelFor(size_t count, unsigned jobs, Fn fn) {
+  size_t threadCount = std::min<size_t>(jobs, count);
+  if (threadCount <= 1) {
+    for (size_t i = 0; i < count; ++i)
+      fn(i);
+    return;
+  }
+
+  std::atomic<size_t> next = 0;
+  auto worker = [&]() {
+    for (size_t i = next++; i < count; i = next++)
+      fn(i);
+  };
+
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < threadCount; ++i)
+    threads.emplace_back(worker);
+  worker();
+
+  for (auto &&thread : threads)
+    thread.join();
+}
+} // namespace hlx
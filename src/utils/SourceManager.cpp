@@ -0,0 +1,129 @@
+#include "SourceManager.h"
+#include "Driver.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+hlx::SourceManager &hlx::SourceManager::get() {
+  static SourceManager sourceManager;
+  return sourceManager;
+}
+
+namespace {
+// Outside of the lock, flushing diagnostics decodes locations.
+[[noreturn]] void reportExhausted() {
+  hlx::error("too many source files to address them with 32-bit offsets");
+}
+} // namespace
+
+uint32_t hlx::SourceManager::allocateRange(size_t size) {
+  // One past the end is still a valid location, it belongs to Eof.
+  constexpr uint64_t limit = uint64_t(1) << 32;
+  uint64_t span = uint64_t(size) + 1;
+  if (nextBase + span <= limit) {
+    uint32_t base = nextBase;
+    nextBase += span;
+    return base;
+  }
+
+  // Every offset was handed out once, the first gap left by removed files
+  // that is large enough is reused.
+  uint64_t gapBegin = 1;
+  for (auto &&[base, entry] : files) {
+    if (gapBegin + span <= base)
+      return gapBegin;
+    gapBegin = uint64_t(base) + entry.size + 1;
+  }
+  if (gapBegin + span > limit)
+    return 0;
+
+  nextBase = gapBegin + span;
+  return gapBegin;
+}
+
+uint32_t hlx::SourceManager::addFile(const SourceFile &file) {
+  std::unique_lock<std::mutex> lock(filesMutex);
+  if (auto it = bases.find(&file); it != bases.end())
+    return it->second;
+
+  uint32_t base = allocateRange(file.buffer.size());
+  if (!base) {
+    lock.unlock();
+    reportExhausted();
+  }
+  bases.emplace(&file, base);
+  files.try_emplace(base, &file, file.path, base, file.buffer.size());
+  return base;
+}
+
+uint32_t hlx::SourceManager::addFile(std::string_view path, uint32_t size,
+                                     std::vector<uint32_t> lineStarts) {
+  std::unique_lock<std::mutex> lock(filesMutex);
+  uint32_t base = allocateRange(size);
+  if (!base) {
+    lock.unlock();
+    reportExhausted();
+  }
+  FileEntry &entry =
+      files.try_emplace(base, nullptr, path, base, size).first->second;
+  std::call_once(entry.linesBuilt,
+                 [&]() { entry.lineStarts = std::move(lineStarts); });
+  return base;
+}
+
+void hlx::SourceManager::removeFile(const SourceFile &file) {
+  std::lock_guard<std::mutex> lock(filesMutex);
+  auto it = bases.find(&file);
+  if (it == bases.end())
+    return;
+
+  files.erase(it->second);
+  bases.erase(it);
+}
+
+const hlx::SourceManager::FileEntry *
+hlx::SourceManager::findFile(uint32_t offset) const {
+  std::lock_guard<std::mutex> lock(filesMutex);
+  auto it = files.upper_bound(offset);
+  if (it == files.begin())
+    return nullptr;
+
+  const FileEntry &entry = std::prev(it)->second;
+  if (offset - entry.base > entry.size)
+    return nullptr;
+  return &entry;
+}
+
+hlx::PresumedLocation hlx::SourceManager::decode(SourceLocation location) const {
+  const FileEntry *entry = findFile(location.offset);
+  if (!entry)
+    return PresumedLocation{"<builtin>", 0, 0};
+
+  std::call_once(entry->linesBuilt, [&]() {
+    entry->lineStarts.emplace_back(0);
+    // Files known only by their line table got it when they were added.
+    if (!entry->file)
+      return;
+
+    const std::string &buffer = entry->file->buffer;
+    const char *data = buffer.data();
+    const char *end = data + buffer.size();
+    for (const char *it = data;
+         (it = static_cast<const char *>(std::memchr(it, '\n', end - it)));
+         ++it)
+      entry->lineStarts.emplace_back(it - data + 1);
+  });
+
+  const std::vector<uint32_t> &lineStarts = entry->lineStarts;
+  uint32_t offset = location.offset - entry->base;
+  auto it = std::upper_bound(lineStarts.begin(), lineStarts.end(), offset);
+
+  int line = it - lineStarts.begin();
+  int col = offset - *(it - 1) + 1;
+  if (const SourceFile *file = entry->file) {
+    if (line == 1)
+      col += file->firstCol - 1;
+    line += file->firstLine - 1;
+  }
+  return PresumedLocation{entry->path, line, col};
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "Utils.h"
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace hlx {
+struct PresumedLocation {
+  std::string_view filepath;
+  int line;
+  int col;
+};
+
+// Maps the 32-bit offsets stored in SourceLocation back to files. Every
+// registered file occupies the offset range [base, base + size], offset 0
+// is reserved for builtins. Line tables are only built when a location of
+// the file is decoded for the first time.
+class SourceManager {
+  struct FileEntry {
+    // Null for files known only by their line table.
+    const SourceFile *file;
+    std::string_view path;
+    uint32_t base;
+    uint32_t size;
+
+    mutable std::once_flag linesBuilt;
+    mutable std::vector<uint32_t> lineStarts;
+
+    FileEntry(const SourceFile *file, std::string_view path, uint32_t base,
+              uint32_t size)
+        : file(file), path(path), base(base), size(size) {}
+  };
+
+  // Keyed by base.
+  std::map<uint32_t, FileEntry> files;
+  std::unordered_map<const SourceFile *, uint32_t> bases;
+  uint32_t nextBase = 1;
+  mutable std::mutex filesMutex;
+
+  // Base of a new range for a file of 'size' bytes, with filesMutex held.
+  // 0 if no range of that size is free.
+  uint32_t allocateRange(size_t size);
+  const FileEntry *findFile(uint32_t offset) const;
+
+public:
+  static SourceManager &get();
+
+  // Returns the base offset of the file, registering it on first use.
+  uint32_t addFile(const SourceFile &file);
+  // Registers a file whose text is not available, e.g. the source of a
+  // loaded module, by its size and the offsets its lines start at.
+  uint32_t addFile(std::string_view path, uint32_t size,
+                   std::vector<uint32_t> lineStarts);
+  // Forgets 'file' before it is destroyed, none of its locations may be
+  // decoded afterwards. Its range is only handed out again once the offsets
+  // past the last file are used up, e.g. after many edits in an editor
+  // session.
+  void removeFile(const SourceFile &file);
+  PresumedLocation decode(SourceLocation location) const;
+};
+} // namespace hlx
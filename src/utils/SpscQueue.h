@@ -0,0 +1,49 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace hlx {
+// Bounded lock-free ring buffer for exactly one producer and one consumer
+// thread. The capacity is rounded up to a power of two.
+template <typename T> class SpscQueue {
+  std::vector<T> slots;
+  size_t mask;
+
+  // Written by the consumer.
+  alignas(64) std::atomic<size_t> head = 0;
+  // Written by the producer.
+  alignas(64) std::atomic<size_t> tail = 0;
+
+public:
+  explicit SpscQueue(size_t capacity) {
+    size_t size = 1;
+    while (size < capacity)
+      size <<= 1;
+
+    slots.resize(size);
+    mask = size - 1;
+  }
+
+  bool tryPush(T &&value) {
+    size_t t = tail.load(std::memory_order_relaxed);
+    if (t - head.load(std::memory_order_acquire) == slots.size())
+      return false;
+
+    slots[t & mask] = std::move(value);
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool tryPop(T &value) {
+    size_t h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire))
+      return false;
+
+    value = std::move(slots[h & mask]);
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+};
+} // namespace hlx
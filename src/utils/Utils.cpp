@@ -1,11 +1,44 @@
-
 #include "Utils.h"
-#include <iostream>
+#include "Diagnostics.h"
+#include "SourceManager.h"
+#include <sstream>
+
+namespace {
+thread_local hlx::DiagnosticCapture *currentCapture = nullptr;
+}
+
 std::nullptr_t hlx::report(SourceLocation location, std::string_view message, bool isWarning) {
-    const auto &[file,line,col]=location;
-    std::cerr<<file<<':'<<line<<':'<<col<<':'
-    <<(isWarning? "warning: " : "error: ")<<message<<"\n";
+    Diagnostic diagnostic{location,std::string(message),isWarning};
+
+    if(currentCapture)
+        currentCapture->diagnostics.emplace_back(std::move(diagnostic));
+    else
+        DiagnosticEngine::get().report(std::move(diagnostic));
 
     return nullptr;
 }
 
+std::string hlx::formatDiagnostic(const Diagnostic &diagnostic) {
+    const auto &[file,line,col]=SourceManager::get().decode(diagnostic.location);
+    std::ostringstream formatted;
+    formatted<<file<<':'<<line<<':'<<col<<':'
+    <<(diagnostic.isWarning? "warning: " : "error: ")<<diagnostic.message<<"\n";
+    return formatted.str();
+}
+
+hlx::DiagnosticCapture::DiagnosticCapture()
+: previous(currentCapture){
+    currentCapture=this;
+}
+
+hlx::DiagnosticCapture::~DiagnosticCapture(){
+    currentCapture=previous;
+}
+
+std::string hlx::DiagnosticCapture::take(){
+    std::string formatted;
+    for(auto &&diagnostic:diagnostics)
+        formatted+=formatDiagnostic(diagnostic);
+    diagnostics.clear();
+    return formatted;
+}
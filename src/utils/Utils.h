@@ -1,7 +1,10 @@
 #pragma once
 #include <cstddef>
+#include <cstdint>
 #include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
 #define varOrReturn(var, init)                                                 \
   auto var = (init);                                                           \
   if (!var)                                                                    \
@@ -22,15 +25,47 @@ struct Dumpable {
 
   virtual void dump(size_t level = 0) const = 0;
 };
+// Offset into the SourceManager, decoded to file:line:col on demand.
 struct SourceLocation {
-  std::string_view filepath;
-  int line;
-  int col;
+  uint32_t offset = 0;
 };
 struct SourceFile {
   std::string_view path;
   std::string buffer = "";
+  // Position of the first byte in 'path', for a file that is a piece of a
+  // larger text, see IncrementalFrontend.
+  uint32_t firstLine = 1;
+  uint32_t firstCol = 1;
 };
+struct Diagnostic {
+  SourceLocation location;
+  std::string message;
+  bool isWarning = false;
+};
+// Goes to the innermost capture on this thread, or the DiagnosticEngine,
+// which prints it when flushed.
 std::nullptr_t report(SourceLocation location, std::string_view message,
                       bool isWarning = false);
+// file:line:col: error: message, with the location decoded at this point.
+std::string formatDiagnostic(const Diagnostic &diagnostic);
+
+// While alive, diagnostics reported on the constructing thread are collected
+// here instead of being printed, so work done on worker threads can be
+// reported in source order afterwards. Captures nest.
+class DiagnosticCapture {
+  std::vector<Diagnostic> diagnostics;
+  DiagnosticCapture *previous;
+
+  friend std::nullptr_t report(SourceLocation, std::string_view, bool);
+
+public:
+  DiagnosticCapture();
+  ~DiagnosticCapture();
+  DiagnosticCapture(const DiagnosticCapture &) = delete;
+  DiagnosticCapture &operator=(const DiagnosticCapture &) = delete;
+
+  // The captured diagnostics, formatted.
+  std::string take();
+  std::vector<Diagnostic> takeDiagnostics() { return std::move(diagnostics); }
+};
 } // namespace hlx
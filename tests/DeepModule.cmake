@@ -0,0 +1,23 @@
+# Writes a program with an expression nested 2 * DEPTH levels deep, emits it
+# as a resolved module with HELIXLANG and loads the module back.
+#
+#   cmake -DHELIXLANG=... -DDEPTH=... -DOUTPUT=... -P DeepModule.cmake
+
+string(REPEAT "(" ${DEPTH} open)
+string(REPEAT "+x)" ${DEPTH} close)
+file(WRITE ${OUTPUT}.hlx
+        "fn main(): void {\n    let x = 1;\n    println(${open}x${close});\n}")
+
+execute_process(COMMAND ${HELIXLANG} ${OUTPUT}.hlx -emit-res ${OUTPUT}.hlxr
+        RESULT_VARIABLE result
+        ERROR_VARIABLE errors)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "failed to emit ${OUTPUT}.hlxr (${result}):\n${errors}")
+endif()
+
+execute_process(COMMAND ${HELIXLANG} ${OUTPUT}.hlxr -llvm-dump
+        RESULT_VARIABLE result
+        ERROR_FILE ${OUTPUT}.ll)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "failed to load ${OUTPUT}.hlxr (${result})")
+endif()
@@ -0,0 +1,31 @@
+# Emits SAMPLE as a resolved module with HELIXLANG and checks that -res-dump
+# prints the same for the module as for the source, up to addresses.
+#
+#   cmake -DHELIXLANG=... -DSAMPLE=... -DOUTPUT=... -P ModuleRoundTrip.cmake
+
+execute_process(COMMAND ${HELIXLANG} ${SAMPLE} -emit-res ${OUTPUT}.hlxr
+        RESULT_VARIABLE result
+        ERROR_VARIABLE errors)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "failed to emit ${OUTPUT}.hlxr:\n${errors}")
+endif()
+
+foreach(input source module)
+    if(input STREQUAL source)
+        set(file ${SAMPLE})
+    else()
+        set(file ${OUTPUT}.hlxr)
+    endif()
+    execute_process(COMMAND ${HELIXLANG} ${file} -res-dump
+            RESULT_VARIABLE result
+            ERROR_VARIABLE ${input})
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "failed to dump ${file}:\n${${input}}")
+    endif()
+    string(REGEX REPLACE "0x[0-9a-f]+" "@" ${input} "${${input}}")
+endforeach()
+
+if(NOT source STREQUAL module)
+    message(FATAL_ERROR "the dump of ${OUTPUT}.hlxr differs, expected:\n"
+            "${source}\ngot:\n${module}")
+endif()
@@ -0,0 +1,29 @@
+# Compiles SAMPLE with HELIXLANG and the space separated FLAGS, runs the
+# module with LLI and compares what it prints with the EXPECTED file.
+#
+#   cmake -DHELIXLANG=... -DLLI=... -DSAMPLE=... -DEXPECTED=... -DOUTPUT=...
+#         [-DFLAGS=...] -P RunSample.cmake
+
+separate_arguments(flags UNIX_COMMAND "${FLAGS}")
+
+execute_process(COMMAND ${HELIXLANG} ${SAMPLE} -llvm-dump ${flags}
+        RESULT_VARIABLE result
+        ERROR_FILE ${OUTPUT}.ll)
+if(NOT result EQUAL 0)
+    file(READ ${OUTPUT}.ll diagnostics)
+    message(FATAL_ERROR "failed to compile ${SAMPLE}:\n${diagnostics}")
+endif()
+
+execute_process(COMMAND ${LLI} ${OUTPUT}.ll
+        RESULT_VARIABLE result
+        OUTPUT_VARIABLE actual
+        ERROR_VARIABLE errors)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "failed to run ${SAMPLE}:\n${errors}")
+endif()
+
+file(READ ${EXPECTED} expected)
+if(NOT actual STREQUAL expected)
+    message(FATAL_ERROR "unexpected output of ${SAMPLE}, expected:\n"
+            "${expected}\ngot:\n${actual}")
+endif()